@@ -0,0 +1,76 @@
+#include "Benchmarks/Benchmark.h"
+#include <algorithm>
+#include <chrono>
+
+volatile float benchmarkSink = 0;
+
+static double Now() {
+  return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double BenchmarkRunner::Time(const function<void(size_t)> &body, size_t &iterations) {
+  double target = minSeconds / repetitions;
+  iterations = 1;
+  while (true) {
+    double start = Now();
+    body(iterations);
+    double elapsed = Now() - start;
+    if (elapsed >= target || iterations >= ((size_t)1 << 30)) break;
+    // Jump close to the target once the timing is meaningful.
+    if (elapsed > target / 16) {
+      iterations = max(iterations + 1, (size_t)(iterations * target / elapsed));
+    } else {
+      iterations *= 2;
+    }
+  }
+
+  vector<double> times;
+  for (int repetition = 0; repetition < repetitions; ++repetition) {
+    double start = Now();
+    body(iterations);
+    times.push_back((Now() - start) / iterations);
+  }
+  sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+static string Escape(const string &str) {
+  string result;
+  for (char c : str) {
+    if (c == '"' || c == '\\') result += '\\';
+    result += c;
+  }
+  return result;
+}
+
+void BenchmarkRunner::WriteJson(FILE *out, const vector<pair<string, string>> &context) const {
+  fprintf(out, "{\n  \"context\": {");
+  for (size_t i = 0; i < context.size(); ++i) {
+    fprintf(out, "%s\n    \"%s\": \"%s\"", i ? "," : "", Escape(context[i].first).c_str(), Escape(context[i].second).c_str());
+  }
+  fprintf(out, "\n  },\n  \"results\": [");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult &r = results[i];
+    fprintf(out, "%s\n    {\"suite\": \"%s\", \"case\": \"%s\", \"variant\": \"%s\", \"size\": %zu, "
+                 "\"iterations\": %zu, \"seconds\": %.9g, \"items_per_second\": %.6g",
+            i ? "," : "", Escape(r.Suite).c_str(), Escape(r.Case).c_str(), Escape(r.Variant).c_str(), r.Size,
+            r.Iterations, r.Seconds, r.ItemsPerSecond);
+    if (r.Value >= 0) {
+      fprintf(out, ", \"value\": %.9g", r.Value);
+    }
+    fprintf(out, "}");
+  }
+  fprintf(out, "\n  ]\n}\n");
+}
+
+void BenchmarkRunner::WriteCsv(FILE *out) const {
+  fprintf(out, "suite,case,variant,size,iterations,seconds,items_per_second,value\n");
+  for (const BenchmarkResult &r : results) {
+    fprintf(out, "%s,%s,%s,%zu,%zu,%.9g,%.6g,", r.Suite.c_str(), r.Case.c_str(), r.Variant.c_str(), r.Size,
+            r.Iterations, r.Seconds, r.ItemsPerSecond);
+    if (r.Value >= 0) {
+      fprintf(out, "%.9g", r.Value);
+    }
+    fprintf(out, "\n");
+  }
+}
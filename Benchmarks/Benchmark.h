@@ -0,0 +1,49 @@
+#pragma once
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+using namespace std;
+
+// One measurement. Suite and Case name the workload, Variant the code path
+// (e.g. tree or bytecode evaluation) and Size its scale (leaves, characters,
+// grid points).
+struct BenchmarkResult {
+  string Suite;
+  string Case;
+  string Variant;
+  size_t Size;
+  // Iterations per repetition and median seconds per iteration.
+  size_t Iterations;
+  double Seconds;
+  // Items (points, characters) processed per second, or 0.
+  double ItemsPerSecond;
+  // Extra metric of the suite, such as a node count, or -1 if there is none.
+  double Value;
+};
+
+class BenchmarkRunner {
+public:
+  BenchmarkRunner(double minSeconds = 0.25, int repetitions = 5) : minSeconds(minSeconds), repetitions(repetitions) {}
+
+  // Times body, which runs the workload the given number of times. The
+  // number of iterations is doubled until one repetition takes about
+  // minSeconds / repetitions; body is then run that many times per
+  // repetition and the median time per iteration is returned.
+  double Time(const function<void(size_t)> &body, size_t &iterations);
+
+  void Add(const BenchmarkResult &result) { results.push_back(result); }
+  const vector<BenchmarkResult> &Results() const { return results; }
+
+  void WriteJson(FILE *out, const vector<pair<string, string>> &context) const;
+  void WriteCsv(FILE *out) const;
+
+private:
+  double minSeconds;
+  int repetitions;
+  vector<BenchmarkResult> results;
+};
+
+// Keeps the compiler from discarding results that are never read.
+extern volatile float benchmarkSink;
@@ -0,0 +1,18 @@
+######################################################################
+# Microbenchmarks of the core library. Build VectorCore.pro first, then
+#   cd Benchmarks && qmake Benchmarks.pro && make
+#   ./Benchmarks --format json --output results.json
+######################################################################
+
+TEMPLATE = app
+TARGET = Benchmarks
+CONFIG += console c++17 sdk_no_version_check
+CONFIG -= qt app_bundle
+INCLUDEPATH += ..
+
+LIBS += -L$$OUT_PWD/.. -lVectorCore
+PRE_TARGETDEPS += $$OUT_PWD/../libVectorCore.a
+
+HEADERS += Benchmark.h
+SOURCES += Benchmark.cpp \
+           main.cpp
@@ -0,0 +1,382 @@
+#include "Benchmarks/Benchmark.h"
+#include "Expr.h"
+#include "ExprArena.h"
+#include "VectorField.h"
+#include "SimdKernels.h"
+#include "Jobs.h"
+#include "Parsing/ParserAlt.h"
+#include "Parsing/PrecedenceParser.h"
+#include <string.h>
+#include <random>
+#include <memory>
+
+using namespace Expression;
+using namespace std;
+
+// Operators used by generated expressions.
+struct OperatorMix {
+  string Name;
+  string Binary;
+  // Chance of wrapping a subexpression in sin or cos.
+  float TrigChance;
+};
+
+static const vector<OperatorMix> mixes = {
+  {"add", "+-", 0},
+  {"mul", "*/", 0},
+  {"pow", "+^", 0},
+  {"trig", "+*", 0.5f},
+  {"mixed", "+-*/^", 0.2f}
+};
+
+// Fully parenthesized random expression over x, y and z with the given
+// number of leaves. Exponents are small constants so that ^ stays finite.
+static string Generate(mt19937 &random, const OperatorMix &mix, size_t leaves) {
+  uniform_real_distribution<float> chance(0, 1);
+  if (leaves <= 1) {
+    switch (random() % 4) {
+      case 0: return "x";
+      case 1: return "y";
+      case 2: return "z";
+      default: return to_string(random() % 9 + 1) + ".5";
+    }
+  }
+  char op = mix.Binary[random() % mix.Binary.size()];
+  string result;
+  if (op == '^') {
+    result = "(" + Generate(random, mix, leaves - 1) + ")^" + to_string(random() % 3 + 2);
+  } else {
+    size_t left = leaves / 2;
+    // A - directly followed by its operand is read as negation.
+    string separator = op == '-' ? " - " : string(1, op);
+    result = "(" + Generate(random, mix, left) + ")" + separator + "(" + Generate(random, mix, leaves - left) + ")";
+  }
+  if (chance(random) < mix.TrigChance) {
+    result = (random() % 2 ? "sin(" : "cos(") + result + ")";
+  }
+  return result;
+}
+
+// Random mixed expression of at least the given number of characters.
+static string GenerateLength(size_t length) {
+  mt19937 random(length);
+  size_t leaves = 2;
+  string result;
+  while ((result = Generate(random, mixes.back(), leaves)).size() < length) {
+    leaves += leaves / 4 + 1;
+  }
+  return result;
+}
+
+struct FieldCase {
+  string Name;
+  string I, J, K;
+};
+
+static const vector<FieldCase> fields = {
+  {"linear", "y", "-x", "z"},
+  {"trig", "sin(x*y)", "cos(y*z)", "x*sin(z)"},
+  {"rational", "x/(y^2+1)", "y*z/(x^2+1)", "(x+y+z)^2"},
+  {"heavy", "sin(x*y)*cos(z)^2+x^3", "cos(x+y+z)*(x^2+y^2)", "sin(x)*sin(y)*sin(z)+z/(x^2+y^2+1)"}
+};
+
+static VectorField *MakeField(const FieldCase &field, shared_ptr<ExprArena> arena) {
+  ExprArena::Scope scope(arena.get());
+  PrecedenceParser parser(LexMode::MultiVariable);
+  Expr *i = parser.Parse(field.I);
+  Expr *j = parser.Parse(field.J);
+  Expr *k = parser.Parse(field.K);
+  if (!i || !j || !k) {
+    fprintf(stderr, "could not parse field %s\n", field.Name.c_str());
+    exit(1);
+  }
+  return new VectorField(i, j, k, arena);
+}
+
+// Points of a cube grid, used as evaluation inputs.
+struct Points {
+  vector<float> Xs, Ys, Zs;
+  Points(size_t n) : Xs(n), Ys(n), Zs(n) {
+    mt19937 random(7);
+    uniform_real_distribution<float> coordinate(-5, 5);
+    for (size_t i = 0; i < n; ++i) {
+      Xs[i] = coordinate(random);
+      Ys[i] = coordinate(random);
+      Zs[i] = coordinate(random);
+    }
+  }
+};
+
+static void EvalSuite(BenchmarkRunner &runner, bool quick) {
+  const size_t numPoints = 4096;
+  Points points(numPoints);
+  vector<float> is(numPoints), js(numPoints), ks(numPoints);
+  vector<size_t> sizes = quick ? vector<size_t>{4, 64} : vector<size_t>{4, 16, 64, 256, 1024};
+
+  for (const OperatorMix &mix : mixes) {
+    for (size_t leaves : sizes) {
+      mt19937 random(leaves);
+      string str = Generate(random, mix, leaves);
+      shared_ptr<ExprArena> arena = make_shared<ExprArena>();
+      ExprArena::Scope scope(arena.get());
+      PrecedenceParser parser(LexMode::MultiVariable);
+      Expr *E = parser.Parse(str);
+      if (!E) {
+        fprintf(stderr, "could not parse %s\n", str.c_str());
+        exit(1);
+      }
+      // Both variants evaluate all three outputs of the same field. The tree
+      // walk visits shared nodes once per parent, like the parsed tree.
+      size_t treeNodes = CountNodes({E});
+      VectorField field(E, new Val(0, 0), new Val(0, 0), arena);
+      size_t iterations;
+      double seconds = runner.Time([&](size_t n) {
+        float sum = 0;
+        for (size_t iteration = 0; iteration < n; ++iteration) {
+          for (size_t i = 0; i < numPoints; ++i) {
+            sum += field.EvalTree(points.Xs[i], points.Ys[i], points.Zs[i]).x;
+          }
+        }
+        benchmarkSink = sum;
+      }, iterations);
+      runner.Add({"eval", mix.Name, "tree", leaves, iterations, seconds, numPoints / seconds, (double)treeNodes});
+
+      seconds = runner.Time([&](size_t n) {
+        float sum = 0;
+        for (size_t iteration = 0; iteration < n; ++iteration) {
+          for (size_t i = 0; i < numPoints; ++i) {
+            sum += field.Eval(points.Xs[i], points.Ys[i], points.Zs[i]).x;
+          }
+        }
+        benchmarkSink = sum;
+      }, iterations);
+      runner.Add({"eval", mix.Name, "bytecode", leaves, iterations, seconds, numPoints / seconds, (double)field.NumNodes()});
+
+      seconds = runner.Time([&](size_t n) {
+        for (size_t iteration = 0; iteration < n; ++iteration) {
+          field.EvalBatch(points.Xs.data(), points.Ys.data(), points.Zs.data(), numPoints, is.data(), js.data(), ks.data());
+        }
+        benchmarkSink = is[0];
+      }, iterations);
+      runner.Add({"eval", mix.Name, "batch", leaves, iterations, seconds, numPoints / seconds, (double)field.NumNodes()});
+    }
+  }
+}
+
+static void ParseSuite(BenchmarkRunner &runner, bool quick) {
+  // ParserAlt is quadratic in the input length, so it stops earlier.
+  vector<size_t> lengths = quick ? vector<size_t>{64, 1024} : vector<size_t>{64, 256, 1024, 4096, 16384, 65536};
+  const size_t maxAltLength = 4096;
+
+  for (size_t length : lengths) {
+    string str = GenerateLength(length);
+    size_t iterations;
+    double seconds = runner.Time([&](size_t n) {
+      ExprArena arena;
+      ExprArena::Scope scope(&arena);
+      PrecedenceParser parser(LexMode::MultiVariable);
+      for (size_t iteration = 0; iteration < n; ++iteration) {
+        if (!parser.Parse(str)) exit(1);
+      }
+    }, iterations);
+    runner.Add({"parse", "mixed", "precedence", str.size(), iterations, seconds, str.size() / seconds, -1});
+
+    if (length > maxAltLength) continue;
+    seconds = runner.Time([&](size_t n) {
+      ExprArena arena;
+      ExprArena::Scope scope(&arena);
+      ParserAlt parser(LexMode::MultiVariable);
+      for (size_t iteration = 0; iteration < n; ++iteration) {
+        if (!parser.Parse(str)) exit(1);
+      }
+    }, iterations);
+    runner.Add({"parse", "mixed", "alt", str.size(), iterations, seconds, str.size() / seconds, -1});
+  }
+}
+
+static void CurlSuite(BenchmarkRunner &runner, bool quick) {
+  for (const FieldCase &fieldCase : fields) {
+    size_t nodes = 0;
+    size_t curlNodes = 0;
+    size_t iterations;
+    // Every repetition gets a fresh field, so the curls built by earlier
+    // ones are freed along with their arena.
+    double seconds = runner.Time([&](size_t n) {
+      VectorField *field = MakeField(fieldCase, make_shared<ExprArena>());
+      nodes = field->NumNodes();
+      for (size_t iteration = 0; iteration < n; ++iteration) {
+        VectorField *curl = field->Curl();
+        curlNodes = curl->NumNodes();
+        delete curl;
+      }
+      delete field;
+    }, iterations);
+    runner.Add({"curl", fieldCase.Name, "symbolic", nodes, iterations, seconds, 0, (double)curlNodes});
+
+    // A dual curl only copies the program of the field.
+    seconds = runner.Time([&](size_t n) {
+      VectorField *field = MakeField(fieldCase, make_shared<ExprArena>());
+      for (size_t iteration = 0; iteration < n; ++iteration) {
+        delete field->Curl(CurlMode::DualNumbers);
+      }
+      delete field;
+    }, iterations);
+    runner.Add({"curl", fieldCase.Name, "dual", nodes, iterations, seconds, 0, -1});
+  }
+
+  // Nested products of sin and cos, whose derivatives share most of their
+  // subtrees, sized by characters.
+  vector<int> depths = quick ? vector<int>{4} : vector<int>{2, 4, 6, 8};
+  for (int depth : depths) {
+    string str = "x";
+    for (int level = 0; level < depth; ++level) {
+      str = "sin(" + str + "*y)*cos(" + str + "*z)";
+    }
+    FieldCase fieldCase = {"nested", str, str, str};
+    size_t curlNodes = 0;
+    size_t iterations;
+    double seconds = runner.Time([&](size_t n) {
+      VectorField *field = MakeField(fieldCase, make_shared<ExprArena>());
+      for (size_t iteration = 0; iteration < n; ++iteration) {
+        VectorField *curl = field->Curl();
+        curlNodes = curl->NumNodes();
+        delete curl;
+      }
+      delete field;
+    }, iterations);
+    runner.Add({"curl", fieldCase.Name, "symbolic", str.size(), iterations, seconds, 0, (double)curlNodes});
+  }
+}
+
+static void MinMaxSuite(BenchmarkRunner &runner, bool quick) {
+  const float range = 5;
+  vector<float> steps = quick ? vector<float>{1, 0.5f} : vector<float>{1, 0.5f, 0.25f, 0.125f};
+
+  for (const FieldCase &fieldCase : fields) {
+    unique_ptr<VectorField> field(MakeField(fieldCase, make_shared<ExprArena>()));
+    for (float step : steps) {
+      size_t perAxis = 0;
+      for (float c = -range; c <= range; c += step) ++perAxis;
+      size_t numPoints = perAxis * perAxis * perAxis;
+      // On the calling thread only, then on the whole shared pool.
+      for (size_t numThreads : {1, 0}) {
+        size_t iterations;
+        double seconds = runner.Time([&](size_t n) {
+          float minLength, maxLength;
+          for (size_t iteration = 0; iteration < n; ++iteration) {
+            field->MinMaxLengths(range, range, range, step, minLength, maxLength, numThreads);
+          }
+          benchmarkSink = maxLength;
+        }, iterations);
+        runner.Add({"minmax", fieldCase.Name, numThreads == 1 ? "serial" : "parallel", numPoints, iterations, seconds, numPoints / seconds, -1});
+      }
+    }
+
+    // Interval branch and bound over the whole box, sized by its evaluations.
+    LengthBounds bounds;
+    size_t iterations;
+    double seconds = runner.Time([&](size_t n) {
+      for (size_t iteration = 0; iteration < n; ++iteration) {
+        field->BoundLengths(range, range, range, bounds);
+      }
+      benchmarkSink = bounds.Max;
+    }, iterations);
+    runner.Add({"minmax", fieldCase.Name, "bound", bounds.Evaluations, iterations, seconds, bounds.Evaluations / seconds, bounds.Max});
+  }
+}
+
+struct CurveCase {
+  string Name;
+  string X, Y, Z;
+  float TMin, TMax;
+};
+
+static const vector<CurveCase> curves = {
+  {"line", "t", "2*t", "3", 0, 10},
+  {"helix", "cos(t)", "sin(t)", "t/5", 0, 20},
+  {"spiral", "t*cos(t)", "t*sin(t)", "0", 0, 30}
+};
+
+static void FunctionSuite(BenchmarkRunner &runner, bool quick) {
+  vector<int> numVectors = quick ? vector<int>{20} : vector<int>{5, 20, 100, 1000};
+  for (const CurveCase &curve : curves) {
+    ExprArena arena;
+    ExprArena::Scope scope(&arena);
+    PrecedenceParser parser(LexMode::SingleVariable);
+    Expr *x = parser.Parse(curve.X);
+    Expr *y = parser.Parse(curve.Y);
+    Expr *z = parser.Parse(curve.Z);
+    if (!x || !y || !z) {
+      fprintf(stderr, "could not parse curve %s\n", curve.Name.c_str());
+      exit(1);
+    }
+    for (int n : numVectors) {
+      FunctionSamples samples;
+      size_t iterations;
+      double seconds = runner.Time([&](size_t count) {
+        for (size_t iteration = 0; iteration < count; ++iteration) {
+          SampleFunction(x, y, z, curve.TMin, curve.TMax, n, samples);
+        }
+      }, iterations);
+      runner.Add({"function", curve.Name, "adaptive", (size_t)n, iterations, seconds, samples.Points.size() / seconds, (double)samples.Points.size()});
+    }
+  }
+}
+
+static void Usage() {
+  fprintf(stderr,
+          "usage: Benchmarks [--format json|csv] [--output file] [--suite eval|parse|curl|minmax|function] [--quick]\n"
+          "  --suite may be given several times; all suites run by default\n"
+          "  --quick runs fewer sizes for a short smoke test\n");
+}
+
+int main(int argc, char **argv) {
+  string format = "json";
+  string output;
+  vector<string> suites;
+  bool quick = false;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--format") && i + 1 < argc) {
+      format = argv[++i];
+    } else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+      output = argv[++i];
+    } else if (!strcmp(argv[i], "--suite") && i + 1 < argc) {
+      suites.push_back(argv[++i]);
+    } else if (!strcmp(argv[i], "--quick")) {
+      quick = true;
+    } else {
+      Usage();
+      return 1;
+    }
+  }
+  if (format != "json" && format != "csv") {
+    Usage();
+    return 1;
+  }
+  auto selected = [&](const string &suite) {
+    return suites.empty() || find(suites.begin(), suites.end(), suite) != suites.end();
+  };
+
+  BenchmarkRunner runner(quick ? 0.05 : 0.25);
+  if (selected("eval")) EvalSuite(runner, quick);
+  if (selected("parse")) ParseSuite(runner, quick);
+  if (selected("curl")) CurlSuite(runner, quick);
+  if (selected("minmax")) MinMaxSuite(runner, quick);
+  if (selected("function")) FunctionSuite(runner, quick);
+
+  FILE *out = stdout;
+  if (!output.empty()) {
+    out = fopen(output.c_str(), "w");
+    if (!out) {
+      fprintf(stderr, "could not open %s\n", output.c_str());
+      return 1;
+    }
+  }
+  if (format == "csv") {
+    runner.WriteCsv(out);
+  } else {
+    runner.WriteJson(out, {{"isa", Simd::IsaName(Simd::ActiveIsa())}, {"threads", to_string(ThreadPool::Shared().NumThreads() + 1)}, {"quick", quick ? "true" : "false"}});
+  }
+  if (out != stdout) fclose(out);
+  return 0;
+}
@@ -0,0 +1,753 @@
+#include "Bytecode.h"
+#include <string.h>
+
+using namespace Expression;
+
+// Returns the children of E (at most two) and how many there are.
+static size_t Children(Expr *E, Expr *&first, Expr *&second) {
+  Expr **firstSlot, **secondSlot;
+  size_t numChildren = ChildSlots(E, firstSlot, secondSlot);
+  first = firstSlot ? *firstSlot : nullptr;
+  second = secondSlot ? *secondSlot : nullptr;
+  return numChildren;
+}
+
+static OpCode OpFor(ExprKind kind) {
+  switch (kind) {
+    case ExprKind::ValKind: return OpCode::ConstOp;
+    // t is evaluated from the first argument, just like x.
+    case ExprKind::TKind: return OpCode::XOp;
+    case ExprKind::XKind: return OpCode::XOp;
+    case ExprKind::YKind: return OpCode::YOp;
+    case ExprKind::ZKind: return OpCode::ZOp;
+    case ExprKind::NegKind: return OpCode::NegOp;
+    case ExprKind::AddKind: return OpCode::AddOp;
+    case ExprKind::SubKind: return OpCode::SubOp;
+    case ExprKind::MultKind: return OpCode::MultOp;
+    case ExprKind::DivKind: return OpCode::DivOp;
+    case ExprKind::PowKind: return OpCode::PowOp;
+    case ExprKind::SinKind: return OpCode::SinOp;
+    case ExprKind::CosKind: return OpCode::CosOp;
+    case ExprKind::LogKind: return OpCode::LogOp;
+  }
+  return OpCode::ConstOp;
+}
+
+Program Compiler::Compile(const vector<Expr *> &roots) {
+  program = Program();
+  uses.clear();
+  registers.clear();
+  freeRegisters.clear();
+  emitted.clear();
+  privateNumerators.clear();
+
+  // Each root holds one use that is never released, so output registers
+  // are never recycled for later roots.
+  for (Expr *Root : roots) {
+    CountUses(Root);
+  }
+  for (Expr *Root : roots) {
+    program.Outputs.push_back(Emit(Root));
+  }
+  FoldLoads();
+  return program;
+}
+
+void Compiler::CountUses(Expr *E) {
+  if (++uses[E] > 1) {
+    // Children of a shared node were already counted on the first visit.
+    return;
+  }
+  Expr *first, *second;
+  size_t numChildren = Children(E, first, second);
+  if (numChildren > 0) CountUses(first);
+  if (numChildren > 1) CountUses(second);
+}
+
+uint16_t Compiler::Emit(Expr *E) {
+  auto It = registers.find(E);
+  if (It != registers.end()) {
+    return It->second;
+  }
+
+  Instruction I = {OpFor(E->Kind), 0, 0, 0, 0.0f};
+  Expr *first, *second;
+  size_t numChildren = Children(E, first, second);
+  size_t numeratorStart = 0;
+  if (E->Kind == ExprKind::DivKind) {
+    // The numerator is emitted last, so that Eval can skip it where the
+    // denominator is clamped.
+    I.B = Emit(second);
+    numeratorStart = program.Code.size();
+    I.A = Emit(first);
+  } else {
+    if (numChildren > 0) I.A = Emit(first);
+    if (numChildren > 1) I.B = Emit(second);
+  }
+  if (E->Kind == ExprKind::ValKind) I.Imm = static_cast<Val *>(E)->V;
+
+  // Operands are read before the destination is written, so the destination
+  // may reuse a register freed by this very instruction.
+  if (numChildren > 0) Release(first);
+  if (E->Kind == ExprKind::DivKind) {
+    // The numerator's instructions are private to it if all of their nodes
+    // have had their last use.
+    bool isPrivate = numeratorStart < program.Code.size();
+    for (size_t i = numeratorStart; i < program.Code.size() && isPrivate; ++i) {
+      isPrivate = uses[emitted[i]] == 0;
+    }
+    if (isPrivate) {
+      privateNumerators[program.Code.size()] = numeratorStart;
+    }
+  }
+  if (numChildren > 1) Release(second);
+  I.Dst = Allocate();
+  program.Code.push_back(I);
+  emitted.push_back(E);
+  registers[E] = I.Dst;
+  return I.Dst;
+}
+
+uint16_t Compiler::Allocate() {
+  if (!freeRegisters.empty()) {
+    uint16_t reg = freeRegisters.back();
+    freeRegisters.pop_back();
+    return reg;
+  }
+  return (uint16_t)program.NumRegisters++;
+}
+
+void Compiler::Release(Expr *E) {
+  if (--uses[E] == 0) {
+    freeRegisters.push_back(registers[E]);
+  }
+}
+
+Program Expression::Compile(const vector<Expr *> &roots) {
+  Compiler compiler;
+  return compiler.Compile(roots);
+}
+
+static ScalarOpCode ScalarOpFor(OpCode op) {
+  switch (op) {
+    case OpCode::NegOp: return ScalarOpCode::NegScalar;
+    case OpCode::AddOp: return ScalarOpCode::AddScalar;
+    case OpCode::SubOp: return ScalarOpCode::SubScalar;
+    case OpCode::MultOp: return ScalarOpCode::MultScalar;
+    case OpCode::DivOp: return ScalarOpCode::DivScalar;
+    case OpCode::PowOp: return ScalarOpCode::PowScalar;
+    case OpCode::SinOp: return ScalarOpCode::SinScalar;
+    case OpCode::CosOp: return ScalarOpCode::CosScalar;
+    default: return ScalarOpCode::LogScalar;
+  }
+}
+
+void Compiler::FoldLoads() {
+  // Constants are told apart bit for bit, like the Interner does.
+  map<uint32_t, uint16_t> constantRegisters;
+  for (const Instruction &I : program.Code) {
+    if (I.Op == OpCode::ConstOp) {
+      uint32_t bits;
+      memcpy(&bits, &I.Imm, sizeof(float));
+      if (constantRegisters.emplace(bits, (uint16_t)(3 + program.ScalarConstants.size())).second) {
+        program.ScalarConstants.push_back(I.Imm);
+      }
+    }
+  }
+  size_t base = 3 + program.ScalarConstants.size();
+  if (base + program.NumRegisters > 65536) {
+    program.ScalarConstants.clear();
+    return;
+  }
+
+  // Numerators starting at each instruction, by the index of their DivOp,
+  // and the SkipScalar of each numerator being folded, by that same index.
+  map<size_t, vector<size_t>> numeratorsAt;
+  for (auto &numerator : privateNumerators) {
+    numeratorsAt[numerator.second].push_back(numerator.first);
+  }
+  map<size_t, size_t> skips;
+
+  // Register of the scalar file that holds the current value of each
+  // register of Code. Loads only update this; other instructions read
+  // through it and write to their own register after the loaded ones.
+  vector<uint16_t> current(program.NumRegisters);
+  vector<ScalarInstruction> &code = program.ScalarCode;
+  for (size_t index = 0; index < program.Code.size(); ++index) {
+    const Instruction &I = program.Code[index];
+    auto Starting = numeratorsAt.find(index);
+    if (Starting != numeratorsAt.end()) {
+      // The denominator was computed before the numerator started and stays
+      // in its register until the DivOp.
+      for (size_t div : Starting->second) {
+        skips[div] = code.size();
+        code.push_back({ScalarOpCode::SkipScalar, 0, 0, current[program.Code[div].B]});
+      }
+    }
+    switch (I.Op) {
+      case OpCode::ConstOp: {
+        uint32_t bits;
+        memcpy(&bits, &I.Imm, sizeof(float));
+        current[I.Dst] = constantRegisters[bits];
+        break;
+      }
+      case OpCode::XOp: current[I.Dst] = 0; break;
+      case OpCode::YOp: current[I.Dst] = 1; break;
+      case OpCode::ZOp: current[I.Dst] = 2; break;
+      default: {
+        auto Skip = skips.find(index);
+        if (Skip != skips.end()) {
+          size_t length = code.size() - Skip->second - 1;
+          if (length == 0) {
+            // The numerator was all loads, so the skip is the last
+            // instruction and has nothing to skip.
+            code.pop_back();
+          } else {
+            // Skips too long to encode are left as no-ops.
+            code[Skip->second].Dst = length <= 65535 ? (uint16_t)length : 0;
+          }
+        }
+        ScalarInstruction Folded = {ScalarOpFor(I.Op), (uint16_t)(base + I.Dst), current[I.A], current[I.B]};
+        current[I.Dst] = Folded.Dst;
+        code.push_back(Folded);
+      }
+    }
+  }
+  for (uint16_t output : program.Outputs) {
+    program.ScalarOutputs.push_back(current[output]);
+  }
+  program.NumScalarRegisters = base + program.NumRegisters;
+}
+
+// The arithmetic here deliberately mirrors the Eval methods in Expr.h so that
+// both evaluation paths produce bit-identical results.
+//
+// Where the compiler allows it, each handler jumps straight to the next
+// instruction's handler (threaded dispatch) instead of back to one switch.
+// Every handler then has an indirect branch of its own, which predicts far
+// better on long programs than the single branch of a switch.
+void Program::Eval(float x, float y, float z, float *results) const {
+  if (NumScalarRegisters == 0 || NumScalarRegisters > MaxStackScalarRegisters) {
+    // Loads could not be folded, or the registers do not fit on the stack.
+    // A batch of one point computes the same values.
+    vector<float *> outputs(Outputs.size());
+    for (size_t i = 0; i < outputs.size(); ++i) outputs[i] = results + i;
+    EvalBatch(&x, &y, &z, 1, outputs.data());
+    return;
+  }
+  float R[MaxStackScalarRegisters];
+  R[0] = x;
+  R[1] = y;
+  R[2] = z;
+  for (size_t i = 0; i < ScalarConstants.size(); ++i) {
+    R[3 + i] = ScalarConstants[i];
+  }
+
+  const ScalarInstruction *I = ScalarCode.data();
+  const ScalarInstruction *End = I + ScalarCode.size();
+#if defined(__GNUC__)
+  // Indexed by ScalarOpCode.
+  static const void *const handlers[] = {
+    &&NegScalarLabel, &&AddScalarLabel, &&SubScalarLabel, &&MultScalarLabel, &&DivScalarLabel,
+    &&PowScalarLabel, &&SinScalarLabel, &&CosScalarLabel, &&LogScalarLabel, &&SkipScalarLabel
+  };
+#define HANDLER(op) op##Label:
+#define NEXT() if (++I == End) goto done; goto *handlers[I->Op]
+  if (I == End) goto done;
+  goto *handlers[I->Op];
+#else
+#define HANDLER(op) case ScalarOpCode::op:
+#define NEXT() break
+  for (; I != End; ++I) {
+    switch (I->Op) {
+#endif
+      HANDLER(NegScalar) R[I->Dst] = -1 * R[I->A]; NEXT();
+      HANDLER(AddScalar) R[I->Dst] = R[I->A] + R[I->B]; NEXT();
+      HANDLER(SubScalar) R[I->Dst] = R[I->A] - R[I->B]; NEXT();
+      HANDLER(MultScalar) R[I->Dst] = R[I->A] * R[I->B]; NEXT();
+      HANDLER(DivScalar) {
+        float r = R[I->B];
+        if (r <= 0.00001) {
+          R[I->Dst] = 1000000000.0;
+        } else {
+          R[I->Dst] = R[I->A] / r;
+        }
+        NEXT();
+      }
+      HANDLER(PowScalar) R[I->Dst] = pow(R[I->A], R[I->B]); NEXT();
+      HANDLER(SinScalar) R[I->Dst] = sin(R[I->A]); NEXT();
+      HANDLER(CosScalar) R[I->Dst] = cos(R[I->A]); NEXT();
+      HANDLER(LogScalar) R[I->Dst] = log(R[I->A]); NEXT();
+      HANDLER(SkipScalar) {
+        if (R[I->B] <= 0.00001) {
+          I += I->Dst;
+        }
+        NEXT();
+      }
+#if !defined(__GNUC__)
+    }
+  }
+#endif
+#undef HANDLER
+#undef NEXT
+done:
+  for (size_t i = 0; i < ScalarOutputs.size(); ++i) {
+    results[i] = R[ScalarOutputs[i]];
+  }
+}
+
+void Program::EvalBatch(const float *xs, const float *ys, const float *zs, size_t n, float *const *results) const {
+  const size_t B = BatchSize;
+  vector<float> registerFile(NumRegisters * B);
+
+  for (size_t start = 0; start < n; start += B) {
+    const size_t count = n - start < B ? n - start : B;
+    const float *X = xs + start;
+    const float *Y = ys + start;
+    const float *Z = zs + start;
+
+    for (const Instruction &I : Code) {
+      float *D = registerFile.data() + I.Dst * B;
+      const float *L = registerFile.data() + I.A * B;
+      const float *R = registerFile.data() + I.B * B;
+      switch (I.Op) {
+        case OpCode::ConstOp:
+          for (size_t i = 0; i < count; ++i) D[i] = I.Imm;
+          break;
+        case OpCode::XOp:
+          for (size_t i = 0; i < count; ++i) D[i] = X[i];
+          break;
+        case OpCode::YOp:
+          for (size_t i = 0; i < count; ++i) D[i] = Y[i];
+          break;
+        case OpCode::ZOp:
+          for (size_t i = 0; i < count; ++i) D[i] = Z[i];
+          break;
+        case OpCode::NegOp:
+          for (size_t i = 0; i < count; ++i) D[i] = -1 * L[i];
+          break;
+        case OpCode::AddOp:
+          for (size_t i = 0; i < count; ++i) D[i] = L[i] + R[i];
+          break;
+        case OpCode::SubOp:
+          for (size_t i = 0; i < count; ++i) D[i] = L[i] - R[i];
+          break;
+        case OpCode::MultOp:
+          for (size_t i = 0; i < count; ++i) D[i] = L[i] * R[i];
+          break;
+        case OpCode::DivOp:
+          for (size_t i = 0; i < count; ++i) {
+            float r = R[i];
+            D[i] = r <= 0.00001 ? 1000000000.0f : L[i] / r;
+          }
+          break;
+        case OpCode::PowOp:
+          for (size_t i = 0; i < count; ++i) D[i] = pow(L[i], R[i]);
+          break;
+        case OpCode::SinOp:
+          for (size_t i = 0; i < count; ++i) D[i] = sin(L[i]);
+          break;
+        case OpCode::CosOp:
+          for (size_t i = 0; i < count; ++i) D[i] = cos(L[i]);
+          break;
+        case OpCode::LogOp:
+          for (size_t i = 0; i < count; ++i) D[i] = log(L[i]);
+          break;
+      }
+    }
+
+    for (size_t o = 0; o < Outputs.size(); ++o) {
+      const float *Out = registerFile.data() + Outputs[o] * B;
+      float *Result = results[o] + start;
+      for (size_t i = 0; i < count; ++i) Result[i] = Out[i];
+    }
+  }
+}
+
+// Dual number arithmetic for EvalDual and EvalDualBatch. The values are
+// computed exactly like Eval computes them.
+static inline Dual DualConst(float v) {
+  return {v, {0, 0, 0}};
+}
+
+static inline Dual DualVar(float v, int index) {
+  Dual r = {v, {0, 0, 0}};
+  r.D[index] = 1;
+  return r;
+}
+
+static inline Dual DualNeg(const Dual &a) {
+  return {-1 * a.V, {-a.D[0], -a.D[1], -a.D[2]}};
+}
+
+static inline Dual DualAdd(const Dual &a, const Dual &b) {
+  return {a.V + b.V, {a.D[0] + b.D[0], a.D[1] + b.D[1], a.D[2] + b.D[2]}};
+}
+
+static inline Dual DualSub(const Dual &a, const Dual &b) {
+  return {a.V - b.V, {a.D[0] - b.D[0], a.D[1] - b.D[1], a.D[2] - b.D[2]}};
+}
+
+// (fg)' = f'g + fg'
+static inline Dual DualMult(const Dual &a, const Dual &b) {
+  Dual r;
+  r.V = a.V * b.V;
+  for (int k = 0; k < 3; ++k) r.D[k] = a.D[k] * b.V + a.V * b.D[k];
+  return r;
+}
+
+// (f/g)' = (f' - (f/g)g')/g, and 0 where the quotient is clamped.
+static inline Dual DualDiv(const Dual &a, const Dual &b) {
+  if (b.V <= 0.00001) {
+    return DualConst(1000000000.0);
+  }
+  Dual r;
+  r.V = a.V / b.V;
+  for (int k = 0; k < 3; ++k) r.D[k] = (a.D[k] - r.V * b.D[k]) / b.V;
+  return r;
+}
+
+// (f^g)' = g f^(g-1) f' + f^g ln(f) g'. A term is only formed when its
+// derivative factor is nonzero, so that e.g. x^2 is differentiable for
+// negative x (where ln(x) is NaN) and 2^x is for any x.
+static inline Dual DualPow(const Dual &a, const Dual &b) {
+  Dual r;
+  r.V = pow(a.V, b.V);
+  bool variableBase = a.D[0] != 0 || a.D[1] != 0 || a.D[2] != 0;
+  bool variableExponent = b.D[0] != 0 || b.D[1] != 0 || b.D[2] != 0;
+  float powerRule = variableBase ? b.V * pow(a.V, b.V - 1) : 0;
+  float logRule = variableExponent ? r.V * log(a.V) : 0;
+  for (int k = 0; k < 3; ++k) {
+    r.D[k] = (a.D[k] != 0 ? powerRule * a.D[k] : 0) + (b.D[k] != 0 ? logRule * b.D[k] : 0);
+  }
+  return r;
+}
+
+static inline Dual DualSin(const Dual &a) {
+  float c = cos(a.V);
+  return {sin(a.V), {c * a.D[0], c * a.D[1], c * a.D[2]}};
+}
+
+static inline Dual DualCos(const Dual &a) {
+  float s = -sin(a.V);
+  return {cos(a.V), {s * a.D[0], s * a.D[1], s * a.D[2]}};
+}
+
+static inline Dual DualLog(const Dual &a) {
+  return {log(a.V), {a.D[0] / a.V, a.D[1] / a.V, a.D[2] / a.V}};
+}
+
+void Program::EvalDual(float x, float y, float z, Dual *results) const {
+  Dual stackRegisters[MaxStackRegisters];
+  vector<Dual> heapRegisters;
+  Dual *R = stackRegisters;
+  if (NumRegisters > MaxStackRegisters) {
+    heapRegisters.resize(NumRegisters);
+    R = heapRegisters.data();
+  }
+
+  for (const Instruction &I : Code) {
+    switch (I.Op) {
+      case OpCode::ConstOp: R[I.Dst] = DualConst(I.Imm); break;
+      case OpCode::XOp: R[I.Dst] = DualVar(x, 0); break;
+      case OpCode::YOp: R[I.Dst] = DualVar(y, 1); break;
+      case OpCode::ZOp: R[I.Dst] = DualVar(z, 2); break;
+      case OpCode::NegOp: R[I.Dst] = DualNeg(R[I.A]); break;
+      case OpCode::AddOp: R[I.Dst] = DualAdd(R[I.A], R[I.B]); break;
+      case OpCode::SubOp: R[I.Dst] = DualSub(R[I.A], R[I.B]); break;
+      case OpCode::MultOp: R[I.Dst] = DualMult(R[I.A], R[I.B]); break;
+      case OpCode::DivOp: R[I.Dst] = DualDiv(R[I.A], R[I.B]); break;
+      case OpCode::PowOp: R[I.Dst] = DualPow(R[I.A], R[I.B]); break;
+      case OpCode::SinOp: R[I.Dst] = DualSin(R[I.A]); break;
+      case OpCode::CosOp: R[I.Dst] = DualCos(R[I.A]); break;
+      case OpCode::LogOp: R[I.Dst] = DualLog(R[I.A]); break;
+    }
+  }
+
+  for (size_t i = 0; i < Outputs.size(); ++i) {
+    results[i] = R[Outputs[i]];
+  }
+}
+
+void Program::EvalDualBatch(const float *xs, const float *ys, const float *zs, size_t n, Dual *const *results) const {
+  // Each register is stored as four planes of BatchSize floats: the values,
+  // then the derivatives with respect to x, y and z. The linear rules then
+  // run as plain loops over the planes.
+  const size_t B = BatchSize;
+  vector<float> registerFile(NumRegisters * 4 * B);
+
+  for (size_t start = 0; start < n; start += B) {
+    const size_t count = n - start < B ? n - start : B;
+    const float *X = xs + start;
+    const float *Y = ys + start;
+    const float *Z = zs + start;
+
+    for (const Instruction &I : Code) {
+      float *D = registerFile.data() + I.Dst * 4 * B;
+      const float *L = registerFile.data() + I.A * 4 * B;
+      const float *R = registerFile.data() + I.B * 4 * B;
+      switch (I.Op) {
+        case OpCode::ConstOp:
+        case OpCode::XOp:
+        case OpCode::YOp:
+        case OpCode::ZOp: {
+          const float *V = I.Op == OpCode::XOp ? X : I.Op == OpCode::YOp ? Y : Z;
+          for (size_t i = 0; i < count; ++i) D[i] = I.Op == OpCode::ConstOp ? I.Imm : V[i];
+          for (size_t k = 1; k <= 3; ++k) {
+            float d = (int)k == I.Op - OpCode::ConstOp ? 1 : 0;
+            for (size_t i = 0; i < count; ++i) D[k * B + i] = d;
+          }
+          break;
+        }
+        case OpCode::NegOp:
+          for (size_t i = 0; i < count; ++i) D[i] = -1 * L[i];
+          for (size_t k = 1; k <= 3; ++k) {
+            for (size_t i = 0; i < count; ++i) D[k * B + i] = -L[k * B + i];
+          }
+          break;
+        case OpCode::AddOp:
+          for (size_t k = 0; k <= 3; ++k) {
+            for (size_t i = 0; i < count; ++i) D[k * B + i] = L[k * B + i] + R[k * B + i];
+          }
+          break;
+        case OpCode::SubOp:
+          for (size_t k = 0; k <= 3; ++k) {
+            for (size_t i = 0; i < count; ++i) D[k * B + i] = L[k * B + i] - R[k * B + i];
+          }
+          break;
+        case OpCode::MultOp:
+          // Derivatives first: D may alias L or R, whose values they need.
+          for (size_t k = 1; k <= 3; ++k) {
+            for (size_t i = 0; i < count; ++i) D[k * B + i] = L[k * B + i] * R[i] + L[i] * R[k * B + i];
+          }
+          for (size_t i = 0; i < count; ++i) D[i] = L[i] * R[i];
+          break;
+        default:
+          // Division and the transcendental functions go through the scalar
+          // rules one point at a time.
+          for (size_t i = 0; i < count; ++i) {
+            Dual a = {L[i], {L[B + i], L[2 * B + i], L[3 * B + i]}};
+            Dual b = {R[i], {R[B + i], R[2 * B + i], R[3 * B + i]}};
+            Dual r;
+            switch (I.Op) {
+              case OpCode::DivOp: r = DualDiv(a, b); break;
+              case OpCode::PowOp: r = DualPow(a, b); break;
+              case OpCode::SinOp: r = DualSin(a); break;
+              case OpCode::CosOp: r = DualCos(a); break;
+              default: r = DualLog(a); break;
+            }
+            D[i] = r.V;
+            for (size_t k = 0; k < 3; ++k) D[(k + 1) * B + i] = r.D[k];
+          }
+          break;
+      }
+    }
+
+    for (size_t o = 0; o < Outputs.size(); ++o) {
+      const float *Out = registerFile.data() + Outputs[o] * 4 * B;
+      Dual *Result = results[o] + start;
+      for (size_t i = 0; i < count; ++i) {
+        Result[i] = {Out[i], {Out[B + i], Out[2 * B + i], Out[3 * B + i]}};
+      }
+    }
+  }
+}
+
+// Interval arithmetic for EvalInterval. Ends are computed in double and
+// rounded outwards to float once per instruction; that one float ulp covers
+// both the double rounding here and the float rounding of Eval. NaN ends
+// only arise from inf - inf and the like, and become infinite.
+static const Interval emptyInterval = {INFINITY, -INFINITY};
+static const Interval entireInterval = {-INFINITY, INFINITY};
+
+static inline Interval Outward(double lo, double hi) {
+  if (isnan(lo)) lo = -INFINITY;
+  if (isnan(hi)) hi = INFINITY;
+  return {nextafterf((float)lo, -INFINITY), nextafterf((float)hi, INFINITY)};
+}
+
+// Ends of [alo, ahi] * [blo, bhi], taking 0 * inf as 0 since an infinite
+// end only stands for unbounded finite values.
+static inline void Products(double alo, double ahi, double blo, double bhi, double &lo, double &hi) {
+  auto times = [](double a, double b) { return a == 0 || b == 0 ? 0 : a * b; };
+  double p[4] = {times(alo, blo), times(alo, bhi), times(ahi, blo), times(ahi, bhi)};
+  lo = fmin(fmin(p[0], p[1]), fmin(p[2], p[3]));
+  hi = fmax(fmax(p[0], p[1]), fmax(p[2], p[3]));
+}
+
+static inline Interval IntervalNeg(Interval a) {
+  return {-a.Hi, -a.Lo};
+}
+
+static inline Interval IntervalAdd(Interval a, Interval b) {
+  if (a.IsEmpty() || b.IsEmpty()) return emptyInterval;
+  return Outward((double)a.Lo + b.Lo, (double)a.Hi + b.Hi);
+}
+
+static inline Interval IntervalSub(Interval a, Interval b) {
+  if (a.IsEmpty() || b.IsEmpty()) return emptyInterval;
+  return Outward((double)a.Lo - b.Hi, (double)a.Hi - b.Lo);
+}
+
+static inline Interval IntervalMult(Interval a, Interval b) {
+  if (a.IsEmpty() || b.IsEmpty()) return emptyInterval;
+  double lo, hi;
+  Products(a.Lo, a.Hi, b.Lo, b.Hi, lo, hi);
+  return Outward(lo, hi);
+}
+
+// Like Eval, divisors up to 0.00001 give the large constant.
+static inline Interval IntervalDiv(Interval a, Interval b) {
+  if (a.IsEmpty() || b.IsEmpty()) return emptyInterval;
+  const double clamped = 1000000000.0;
+  if (b.Hi <= 0.00001) return {(float)clamped, (float)clamped};
+  // The divisors above the threshold are all positive.
+  double lowest = b.Lo > 0.00001 ? b.Lo : nextafter(0.00001, 1.0);
+  double lo, hi;
+  Products(a.Lo, a.Hi, 1 / (double)b.Hi, 1 / lowest, lo, hi);
+  if (b.Lo <= 0.00001) {
+    lo = fmin(lo, clamped);
+    hi = fmax(hi, clamped);
+  }
+  return Outward(lo, hi);
+}
+
+// Where a power is NaN (a negative base with a fractional exponent) it is
+// left out. With a varying exponent, negative bases are not tracked at all.
+static inline Interval IntervalPow(Interval a, Interval b) {
+  if (b.Lo == 0 && b.Hi == 0) {
+    // pow(x, 0) is 1 for any x, even NaN.
+    return {1, 1};
+  }
+  if (a.IsEmpty() || b.IsEmpty()) return emptyInterval;
+  if (b.Lo != b.Hi) {
+    if (a.Lo < 0) return entireInterval;
+    // a^b = e^(b ln(a)), where ln(0) = -inf gives 0^b correctly.
+    double lo, hi;
+    Products(log((double)a.Lo), log((double)a.Hi), b.Lo, b.Hi, lo, hi);
+    return Outward(exp(lo), exp(hi));
+  }
+
+  double n = b.Lo;
+  if (n != floor(n)) {
+    if (a.Hi < 0) return emptyInterval;
+    double base = fmax(a.Lo, 0);
+    return n > 0 ? Outward(pow(base, n), pow((double)a.Hi, n)) : Outward(pow((double)a.Hi, n), pow(base, n));
+  }
+  // Integer powers: odd ones are increasing, even ones are smallest at 0.
+  double m = fabs(n);
+  double pl = pow((double)a.Lo, m), ph = pow((double)a.Hi, m);
+  double lo = fmin(pl, ph), hi = fmax(pl, ph);
+  if (fmod(m, 2) == 0 && a.Lo <= 0 && a.Hi >= 0) lo = 0;
+  if (n > 0) return Outward(lo, hi);
+  // x^-m = 1 / x^m, where 1 / 0 is inf.
+  if (lo > 0 || hi < 0) return Outward(1 / hi, 1 / lo);
+  if (lo == 0 && hi == 0) return {INFINITY, INFINITY};
+  if (lo == 0) return Outward(1 / hi, INFINITY);
+  if (hi == 0) return Outward(-INFINITY, 1 / lo);
+  return entireInterval;
+}
+
+// Whether at + 2 pi k lies in [lo, hi] for some integer k.
+static inline bool ContainsPeriodic(double lo, double hi, double at) {
+  double k = ceil((lo - at) / (2 * M_PI));
+  return at + 2 * M_PI * k <= hi;
+}
+
+// Sine or cosine, which peak at maxAt and bottom out half a turn later.
+static inline Interval IntervalTrig(Interval a, double (*f)(double), double maxAt) {
+  if (a.IsEmpty()) return emptyInterval;
+  if (isinf(a.Lo) || isinf(a.Hi) || (double)a.Hi - a.Lo >= 2 * M_PI) return {-1, 1};
+  double fl = f(a.Lo), fh = f(a.Hi);
+  double lo = fmin(fl, fh), hi = fmax(fl, fh);
+  if (ContainsPeriodic(a.Lo, a.Hi, maxAt)) hi = 1;
+  if (ContainsPeriodic(a.Lo, a.Hi, maxAt + M_PI)) lo = -1;
+  Interval r = Outward(lo, hi);
+  return {fmaxf(r.Lo, -1), fminf(r.Hi, 1)};
+}
+
+static inline Interval IntervalLog(Interval a) {
+  if (a.IsEmpty() || a.Hi < 0) return emptyInterval;
+  return Outward(log(fmax(a.Lo, 0)), log((double)a.Hi));
+}
+
+void Program::EvalInterval(Interval x, Interval y, Interval z, Interval *results) const {
+  Interval stackRegisters[MaxStackRegisters];
+  vector<Interval> heapRegisters;
+  Interval *R = stackRegisters;
+  if (NumRegisters > MaxStackRegisters) {
+    heapRegisters.resize(NumRegisters);
+    R = heapRegisters.data();
+  }
+
+  for (const Instruction &I : Code) {
+    switch (I.Op) {
+      case OpCode::ConstOp: R[I.Dst] = {I.Imm, I.Imm}; break;
+      case OpCode::XOp: R[I.Dst] = x; break;
+      case OpCode::YOp: R[I.Dst] = y; break;
+      case OpCode::ZOp: R[I.Dst] = z; break;
+      case OpCode::NegOp: R[I.Dst] = IntervalNeg(R[I.A]); break;
+      case OpCode::AddOp: R[I.Dst] = IntervalAdd(R[I.A], R[I.B]); break;
+      case OpCode::SubOp: R[I.Dst] = IntervalSub(R[I.A], R[I.B]); break;
+      case OpCode::MultOp: R[I.Dst] = IntervalMult(R[I.A], R[I.B]); break;
+      case OpCode::DivOp: R[I.Dst] = IntervalDiv(R[I.A], R[I.B]); break;
+      case OpCode::PowOp: R[I.Dst] = IntervalPow(R[I.A], R[I.B]); break;
+      case OpCode::SinOp: R[I.Dst] = IntervalTrig(R[I.A], sin, M_PI / 2); break;
+      case OpCode::CosOp: R[I.Dst] = IntervalTrig(R[I.A], cos, 0); break;
+      case OpCode::LogOp: R[I.Dst] = IntervalLog(R[I.A]); break;
+    }
+  }
+
+  for (size_t i = 0; i < Outputs.size(); ++i) {
+    results[i] = R[Outputs[i]];
+  }
+}
+
+string Program::ToString() const {
+  auto OpName = [](OpCode op) {
+    switch (op) {
+      case OpCode::ConstOp: return "const";
+      case OpCode::XOp: return "x";
+      case OpCode::YOp: return "y";
+      case OpCode::ZOp: return "z";
+      case OpCode::NegOp: return "neg";
+      case OpCode::AddOp: return "add";
+      case OpCode::SubOp: return "sub";
+      case OpCode::MultOp: return "mult";
+      case OpCode::DivOp: return "div";
+      case OpCode::PowOp: return "pow";
+      case OpCode::SinOp: return "sin";
+      case OpCode::CosOp: return "cos";
+      case OpCode::LogOp: return "log";
+    }
+    return "unknown";
+  };
+
+  string str = "";
+  for (const Instruction &I : Code) {
+    str += "r" + to_string(I.Dst) + " = " + OpName(I.Op);
+    switch (I.Op) {
+      case OpCode::ConstOp:
+        str += " " + Precision(I.Imm, 4);
+        break;
+      case OpCode::XOp:
+      case OpCode::YOp:
+      case OpCode::ZOp:
+        break;
+      case OpCode::NegOp:
+      case OpCode::SinOp:
+      case OpCode::CosOp:
+      case OpCode::LogOp:
+        str += " r" + to_string(I.A);
+        break;
+      default:
+        str += " r" + to_string(I.A) + ", r" + to_string(I.B);
+        break;
+    }
+    str += "\n";
+  }
+  for (size_t i = 0; i < Outputs.size(); ++i) {
+    str += "out" + to_string(i) + " = r" + to_string(Outputs[i]) + "\n";
+  }
+  return str;
+}
@@ -0,0 +1,157 @@
+#ifndef VECTORFIELD_BYTECODE
+#define VECTORFIELD_BYTECODE
+#include "Expr.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+using namespace std;
+
+namespace Expression {
+  enum OpCode : uint8_t {
+    ConstOp,
+    XOp,
+    YOp,
+    ZOp,
+    NegOp,
+    AddOp,
+    SubOp,
+    MultOp,
+    DivOp,
+    PowOp,
+    SinOp,
+    CosOp,
+    LogOp
+  };
+
+  // A single register-machine instruction: R[Dst] = Op(R[A], R[B]).
+  // Unary instructions ignore B; loads ignore both A and B.
+  struct Instruction {
+    OpCode Op;
+    uint16_t Dst;
+    uint16_t A;
+    uint16_t B;
+    float Imm;
+  };
+
+  // Operations of Program::ScalarCode: those of OpCode that compute, plus
+  // SkipScalar, which skips the numerator of a quotient that Div clamps.
+  enum ScalarOpCode : uint8_t {
+    NegScalar,
+    AddScalar,
+    SubScalar,
+    MultScalar,
+    DivScalar,
+    PowScalar,
+    SinScalar,
+    CosScalar,
+    LogScalar,
+    SkipScalar
+  };
+
+  // R[Dst] = Op(R[A], R[B]), or for SkipScalar: if R[B] is at most the
+  // denominator Div clamps, skip the next Dst instructions.
+  struct ScalarInstruction {
+    ScalarOpCode Op;
+    uint16_t Dst;
+    uint16_t A;
+    uint16_t B;
+  };
+
+  // A value together with its partial derivatives with respect to x, y and z.
+  struct Dual {
+    float V;
+    float D[3];
+  };
+
+  // The closed range [Lo, Hi] of reals. Empty if Lo > Hi; either end may be
+  // infinite.
+  struct Interval {
+    float Lo;
+    float Hi;
+
+    bool IsEmpty() const { return !(Lo <= Hi); }
+  };
+
+  // A flat, linear form of one or more Expr trees. Each output of the
+  // program is the value of the corresponding root passed to Compile.
+  class Program {
+  public:
+    vector<Instruction> Code;
+    vector<uint16_t> Outputs;
+    size_t NumRegisters = 0;
+
+    // Code with its loads folded into the operands, which Eval runs. Its
+    // register file starts with x, y and z, then ScalarConstants, then the
+    // registers of Code, so that only arithmetic is dispatched per point.
+    // Like Div::Eval, it does not evaluate the numerator of a quotient whose
+    // denominator is clamped, where no other node uses its instructions.
+    // NumScalarRegisters is 0 if the register file would not fit 16-bit
+    // register numbers; Eval then evaluates a batch of one point.
+    vector<ScalarInstruction> ScalarCode;
+    vector<float> ScalarConstants;
+    vector<uint16_t> ScalarOutputs;
+    size_t NumScalarRegisters = 0;
+
+    // Number of registers that are evaluated on the stack. Programs needing
+    // more than this fall back to a heap-allocated register file.
+    static const size_t MaxStackRegisters = 64;
+    // The same for Eval, whose register file also holds the constants.
+    static const size_t MaxStackScalarRegisters = 1024;
+
+    // Number of points evaluated together by EvalBatch. Each instruction is
+    // dispatched once per block of this many points.
+    static const size_t BatchSize = 256;
+
+    bool IsEmpty() const { return Code.empty(); }
+    void Eval(float x, float y, float z, float *results) const;
+    // Structure-of-arrays evaluation of n points. results[i] must point to an
+    // array of n floats that receives output i for every point.
+    void EvalBatch(const float *xs, const float *ys, const float *zs, size_t n, float *const *results) const;
+    // Forward-mode automatic differentiation: evaluates every output together
+    // with its gradient in a single pass over the program. Values are
+    // bit-identical to Eval. t is differentiated like x, which it evaluates
+    // to. Where Div returns its large constant, the derivative is 0.
+    void EvalDual(float x, float y, float z, Dual *results) const;
+    // Dual version of EvalBatch. results[i] must point to n Duals.
+    void EvalDualBatch(const float *xs, const float *ys, const float *zs, size_t n, Dual *const *results) const;
+    // Interval arithmetic: results[i] encloses every value output i takes
+    // for x, y and z within the given intervals, except NaN. Ends are
+    // rounded outwards, so the enclosure holds despite rounding. An output
+    // is empty where every value is NaN (e.g. the log of a negative).
+    void EvalInterval(Interval x, Interval y, Interval z, Interval *results) const;
+    string ToString() const;
+  };
+
+  // Lowers Expr trees into a Program. Nodes that are reachable through more
+  // than one parent pointer (e.g. the Left/Right reuse in Mult::Derivative)
+  // are only emitted once, and registers are recycled as soon as their last
+  // consumer has been emitted. Quotients are emitted denominator first.
+  class Compiler {
+  public:
+    Program Compile(const vector<Expr *> &roots);
+
+  private:
+    Program program;
+    map<Expr *, size_t> uses;
+    map<Expr *, uint16_t> registers;
+    vector<uint16_t> freeRegisters;
+    // Node of each instruction of program.Code.
+    vector<Expr *> emitted;
+    // First instruction of the numerator of each DivOp, by the index of the
+    // DivOp, for numerators whose instructions nothing else uses.
+    map<size_t, size_t> privateNumerators;
+
+    void CountUses(Expr *E);
+    uint16_t Emit(Expr *E);
+    uint16_t Allocate();
+    void Release(Expr *E);
+    // Builds the Scalar members of program from its Code.
+    void FoldLoads();
+  };
+
+  extern Program Compile(const vector<Expr *> &roots);
+}
+
+#endif
@@ -0,0 +1,17 @@
+######################################################################
+# Consistency checks of the core library. Build VectorCore.pro first, then
+#   cd Checks && qmake Checks.pro && make
+#   ./Checks [--check simplify|curl|eval|intern|parser|lexer|simd|threads]
+# Exits with status 1 if any check fails.
+######################################################################
+
+TEMPLATE = app
+TARGET = Checks
+CONFIG += console c++17 sdk_no_version_check
+CONFIG -= qt app_bundle
+INCLUDEPATH += ..
+
+LIBS += -L$$OUT_PWD/.. -lVectorCore
+PRE_TARGETDEPS += $$OUT_PWD/../libVectorCore.a
+
+SOURCES += main.cpp
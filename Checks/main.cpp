@@ -0,0 +1,622 @@
+#include "Expr.h"
+#include "ExprArena.h"
+#include "Simplifier.h"
+#include "VectorField.h"
+#include "SimdKernels.h"
+#include "Streamlines.h"
+#include "Parsing/PrecedenceParser.h"
+#include "Parsing/ParserAlt.h"
+#include "Parsing/Lexer.h"
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <functional>
+#include <memory>
+#include <unordered_set>
+
+using namespace Expression;
+using namespace std;
+
+static int numFailures = 0;
+
+static void Fail(const char *check, const string &what) {
+  fprintf(stderr, "FAIL %s: %s\n", check, what.c_str());
+  ++numFailures;
+}
+
+// Whether a and b agree up to float rounding. Reordered sums can cancel
+// differently, so the tolerance is relative to the larger magnitude.
+static bool Agree(float a, float b) {
+  return fabs(a - b) <= 1e-3f * max(1.0f, max(fabs(a), fabs(b)));
+}
+
+// Whether every subexpression of E is moderate at the point: finite, not
+// huge, and no quotient clamps its denominator. Div evaluates to a huge
+// constant instead of dividing by a denominator near or below 0, which
+// identities such as 0/e = 0 ignore, and huge values lose the precision
+// that e.g. sin of them needs, so such points are skipped.
+static bool Moderate(Expr *E, float x, float y, float z, unordered_set<Expr *> &seen) {
+  if (!seen.insert(E).second) return true;
+  float value = E->Eval(x, y, z);
+  if (!isfinite(value) || fabs(value) > 1e3f) return false;
+  if (E->Kind == ExprKind::DivKind && !(static_cast<Div *>(E)->Right->Eval(x, y, z) > 0.001f)) {
+    return false;
+  }
+  Expr **first, **second;
+  size_t numChildren = ChildSlots(E, first, second);
+  if (numChildren > 0 && !Moderate(*first, x, y, z, seen)) return false;
+  if (numChildren > 1 && !Moderate(*second, x, y, z, seen)) return false;
+  return true;
+}
+
+static bool Moderate(Expr *E, float x, float y, float z) {
+  unordered_set<Expr *> seen;
+  return Moderate(E, x, y, z, seen);
+}
+
+// Random expression over x, y and z with the given number of leaves.
+// Constants are mostly fractional, which the integer-looking identities of
+// the simplifiers must not round away.
+static string Generate(mt19937 &random, size_t leaves) {
+  static const char *constants[] = {"0.5", "1.5", "0.25", "2.75", "0.1", "2", "1", "0"};
+  if (leaves <= 1) {
+    switch (random() % 5) {
+      case 0: return "x";
+      case 1: return "y";
+      case 2: return "z";
+      default: return constants[random() % 8];
+    }
+  }
+  string result;
+  switch (random() % 8) {
+    case 0: result = "sin(" + Generate(random, leaves - 1) + ")"; break;
+    case 1: result = "cos(" + Generate(random, leaves - 1) + ")"; break;
+    case 2: result = "(" + Generate(random, leaves - 1) + ")^" + to_string(random() % 3 + 1); break;
+    default: {
+      const char *ops[] = {"+", " - ", "*", "/", "*"};
+      size_t left = leaves / 2;
+      result = "(" + Generate(random, left) + ")" + ops[random() % 5] + "(" + Generate(random, leaves - left) + ")";
+    }
+  }
+  return result;
+}
+
+// Compares Simplify(E) with E, and the derivatives of E simplified with
+// Simplify and with Expr::Simplify against the unsimplified derivatives, at
+// random points.
+static void CheckSimplify(size_t numExpressions) {
+  mt19937 random(1);
+  uniform_real_distribution<float> coordinate(-2, 2);
+  ExprArena arena;
+  ExprArena::Scope scope(&arena);
+  PrecedenceParser parser(LexMode::MultiVariable);
+  for (size_t n = 0; n < numExpressions; ++n) {
+    string str = Generate(random, random() % 12 + 1);
+    Expr *E = parser.Parse(str);
+    if (!E) {
+      Fail("simplify", "could not parse " + str);
+      continue;
+    }
+    vector<pair<string, Expr *>> exprs = {{str, E}};
+    for (char wrt : {'x', 'y', 'z'}) {
+      exprs.push_back({"d/d" + string(1, wrt) + " " + str, E->Derivative(wrt)});
+    }
+    for (auto &[name, Original] : exprs) {
+      Expr *Legacy = Original->Simplify();
+      Expr *Rewritten = Simplify(Original);
+      for (int point = 0; point < 8; ++point) {
+        float x = coordinate(random), y = coordinate(random), z = coordinate(random);
+        float expected = Original->Eval(x, y, z);
+        if (!Moderate(Original, x, y, z)) continue;
+        float legacy = Legacy->Eval(x, y, z);
+        float rewritten = Rewritten->Eval(x, y, z);
+        if (!Agree(expected, legacy)) {
+          Fail("simplify", "Expr::Simplify of " + name + " gives " + to_string(legacy) + " instead of " + to_string(expected));
+          break;
+        }
+        if (!Agree(expected, rewritten)) {
+          Fail("simplify", "Simplify of " + name + " gives " + to_string(rewritten) + " instead of " + to_string(expected));
+          break;
+        }
+      }
+    }
+  }
+}
+
+// Compare must stay a strict weak order with NaN constants, which e.g.
+// log(0 - 1) folds to and which the simplifiers sort along with the rest,
+// and Simplify must keep them.
+static void CheckSimplifyNaN() {
+  ExprArena arena;
+  ExprArena::Scope scope(&arena);
+  vector<Expr *> vals;
+  for (float value : {NAN, -2.0f, 0.0f, 0.5f, -NAN, 3.0f, NAN}) {
+    vals.push_back(new Val(value, 2));
+  }
+  for (Expr *A : vals) {
+    for (Expr *B : vals) {
+      int ab = Compare(A, B);
+      if ((ab < 0) != (Compare(B, A) > 0)) {
+        Fail("simplify", "Compare of " + A->ToString() + " and " + B->ToString() + " is not antisymmetric");
+      }
+      for (Expr *C : vals) {
+        int bc = Compare(B, C), ac = Compare(A, C);
+        if ((ab < 0 && bc < 0 && ac >= 0) || (ab == 0 && bc == 0 && ac != 0)) {
+          Fail("simplify", "Compare of " + A->ToString() + ", " + B->ToString() + " and " + C->ToString() + " is not transitive");
+        }
+      }
+    }
+  }
+
+  Expr *x = new X(), *y = new Y();
+  Expr *E = new Add(new Mult(new Log(new Sub(new Val(0), new Val(1))), x),
+                    new Add(new Mult(new Val(2), y), new Mult(x, new Log(new Val(-2)))));
+  Expr *Simplified = Simplify(E);
+  if (!isnan(Simplified->Eval(1, 2, 3))) {
+    Fail("simplify", "Simplify of " + E->ToString() + " gives " + Simplified->ToString());
+  }
+}
+
+// Random well-formed input for the parsers: unparenthesized chains of
+// binary operators, negation, implicit products such as 2x, and trig.
+static string GenerateInput(mt19937 &random, int depth) {
+  static const char *leaves[] = {"x", "y", "z", "2", "0.5", "3x", "1.25y"};
+  static const char *ops[] = {" + ", " - ", "*", "/", "^"};
+  string result;
+  size_t operands = random() % 3 + 1;
+  for (size_t operand = 0; operand < operands; ++operand) {
+    if (operand > 0) result += ops[random() % 5];
+    if (random() % 4 == 0) result += "-";
+    switch (depth > 0 ? random() % 4 : 0) {
+      case 1: result += "(" + GenerateInput(random, depth - 1) + ")"; break;
+      case 2: result += (random() % 2 ? "sin(" : "cos(") + GenerateInput(random, depth - 1) + ")"; break;
+      default: result += leaves[random() % 7];
+    }
+  }
+  return result;
+}
+
+// Compares the trees PrecedenceParser builds with those of ParserAlt, which
+// it replaced in the UI. Both must reject the malformed inputs.
+static void CheckParser(size_t numInputs) {
+  mt19937 random(4);
+  ExprArena arena;
+  ExprArena::Scope scope(&arena);
+  vector<string> inputs = {"-x^2", "2x", "3xy", "0.5x^2", "--x", "-sin(x)", "sin(-x)", "x^-2", "x/-y",
+                           "2^3^2", "x^y^z", "x - y + z", "x - y*z^2 + -(x + y)/z", "1.2.3"};
+  for (size_t n = 0; n < numInputs; ++n) {
+    inputs.push_back(GenerateInput(random, 3));
+  }
+  for (const string &str : inputs) {
+    Expr *Expected = ParserAlt(LexMode::MultiVariable).Parse(str);
+    Expr *Actual = PrecedenceParser(LexMode::MultiVariable).Parse(str);
+    if (!Expected || !Actual) {
+      Fail("parser", "could not parse " + str);
+    } else if (Compare(Expected, Actual) != 0) {
+      Fail("parser", "PrecedenceParser parses " + str + " as " + Actual->ToString() + " instead of " + Expected->ToString());
+    }
+  }
+  for (const char *str : {"", "(x", "x)", "x(y)", "sin(x)cos(y)", "x2", "-x-y", "(x)-(y)"}) {
+    if (ParserAlt(LexMode::MultiVariable).Parse(str) || PrecedenceParser(LexMode::MultiVariable).Parse(str)) {
+      Fail("parser", "malformed " + string(str) + " was parsed");
+    }
+  }
+}
+
+// Pins the lexeme stream of the lexer, written as lexeme@Loc with ~ for
+// negation and "failed" appended if lexing failed. A * is inserted before a
+// variable or trig function that follows a number or variable, and every
+// later Loc moves up by one.
+static void CheckLexer() {
+  const pair<const char *, const char *> cases[] = {
+    {"2x", "2@0 *@1 x@2"},
+    {"3xy", "3@0 *@1 x@2 *@3 y@4"},
+    {" 2 x ", "2@1 *@3 x@4"},
+    {"1.25y/z", "1.25@0 *@4 y@5 /@6 z@7"},
+    {"x sin(y)", "x@0 *@2 sin@3 (@6 y@7 )@8"},
+    {"cos(x)y", "cos@0 (@3 x@4 )@5 y@6"},
+    {"(x)(y)", "(@0 x@1 )@2 (@3 y@4 )@5"},
+    {"x2", "x@0 2@1"},
+    {"2.50 - x", "2.50@0 -@5 x@7"},
+    {"-x^2", "~@0 x@1 ^@2 2@3"},
+    {"x - -y", "x@0 -@2 ~@4 y@5"},
+    {"x # y", "x@0 failed"},
+    {"t", "failed"}
+  };
+  for (const auto &[str, expected] : cases) {
+    Lexer lexer(LexMode::MultiVariable, nullptr);
+    vector<Lexeme> lexemes = lexer.Lex(str);
+    string actual;
+    for (const Lexeme &L : lexemes) {
+      actual += (actual.empty() ? "" : " ") + Lexer::LexemeStr(L) + "@" + to_string(L.Loc);
+    }
+    if (lexer.Failed()) {
+      actual += actual.empty() ? "failed" : " failed";
+    }
+    if (actual != expected) {
+      Fail("lexer", "\"" + string(str) + "\" lexes to " + actual + " instead of " + expected);
+    }
+  }
+}
+
+static string VecString(const Vec3 &v) {
+  return to_string(v.x) + " " + to_string(v.y) + " " + to_string(v.z);
+}
+
+// Compares the symbolic curl of random fields with the curl taken from the
+// Jacobian of dual-number evaluation, at random points.
+static void CheckCurl(size_t numFields) {
+  mt19937 random(2);
+  uniform_real_distribution<float> coordinate(-2, 2);
+  const char axes[] = {'x', 'y', 'z'};
+  for (size_t n = 0; n < numFields; ++n) {
+    shared_ptr<ExprArena> arena = make_shared<ExprArena>();
+    ExprArena::Scope scope(arena.get());
+    PrecedenceParser parser(LexMode::MultiVariable);
+    string strs[3];
+    Expr *components[3];
+    for (int c = 0; c < 3; ++c) {
+      strs[c] = Generate(random, random() % 8 + 1);
+      components[c] = parser.Parse(strs[c]);
+      if (!components[c]) {
+        Fail("curl", "could not parse " + strs[c]);
+        return;
+      }
+    }
+    string name = "(" + strs[0] + ", " + strs[1] + ", " + strs[2] + ")";
+    // The components and their partial derivatives, taken before the field
+    // interns the components in place. The dual curl is 0 where Div clamps
+    // and the symbolic one is not, so points where either is not moderate
+    // are skipped.
+    vector<Expr *> partials(components, components + 3);
+    for (Expr *Component : components) {
+      for (char wrt : axes) {
+        partials.push_back(Component->Derivative(wrt));
+      }
+    }
+
+    VectorField field(components[0], components[1], components[2], arena);
+    unique_ptr<VectorField> symbolic(field.Curl(CurlMode::Symbolic));
+    unique_ptr<VectorField> dual(field.Curl(CurlMode::DualNumbers));
+    for (int point = 0; point < 8; ++point) {
+      float x = coordinate(random), y = coordinate(random), z = coordinate(random);
+      bool moderate = true;
+      for (Expr *Partial : partials) {
+        moderate = moderate && Moderate(Partial, x, y, z);
+      }
+      if (!moderate) continue;
+      Vec3 expected = dual->Eval(x, y, z);
+      Vec3 actual = symbolic->Eval(x, y, z);
+      if (!Agree(expected.x, actual.x) || !Agree(expected.y, actual.y) || !Agree(expected.z, actual.z)) {
+        Fail("curl", "symbolic curl of " + name + " gives " + VecString(actual) + " instead of " + VecString(expected));
+        break;
+      }
+    }
+    // The dual curl builds the symbolic one only when its expressions are
+    // asked for, and then the same one as CurlMode::Symbolic.
+    if (dual->ToString() != symbolic->ToString()) {
+      Fail("curl", "dual curl of " + name + " is " + dual->ToString() + " instead of " + symbolic->ToString());
+    }
+  }
+}
+
+// Whether a and b are the same float, counting every NaN as the same.
+static bool Identical(float a, float b) {
+  return memcmp(&a, &b, sizeof(float)) == 0 || (isnan(a) && isnan(b));
+}
+
+static bool Identical(const Vec3 &a, const Vec3 &b) {
+  return Identical(a.x, b.x) && Identical(a.y, b.y) && Identical(a.z, b.z);
+}
+
+// Evaluates random trees before and after a VectorField interns them in
+// place. The trees passed in, the interned ones and the compiled program
+// must all give the values the trees gave before, to the bit.
+static void CheckIntern(size_t numFields) {
+  mt19937 random(6);
+  uniform_real_distribution<float> coordinate(-2, 2);
+  ExprArena arena;
+  ExprArena::Scope scope(&arena);
+  PrecedenceParser parser(LexMode::MultiVariable);
+  for (size_t n = 0; n < numFields; ++n) {
+    // Components built from a few shared parts, so that interning merges
+    // subtrees within and across them.
+    string parts[3];
+    for (string &part : parts) {
+      part = Generate(random, random() % 6 + 1);
+    }
+    string strs[3];
+    Expr *components[3];
+    for (int c = 0; c < 3; ++c) {
+      strs[c] = "(" + parts[random() % 3] + ")*(" + parts[random() % 3] + ") - (" + parts[random() % 3] + ")";
+      components[c] = parser.Parse(strs[c]);
+    }
+    string name = "(" + strs[0] + ", " + strs[1] + ", " + strs[2] + ")";
+    vector<Vec3> points, before;
+    for (int point = 0; point < 8; ++point) {
+      Vec3 p = {coordinate(random), coordinate(random), coordinate(random)};
+      points.push_back(p);
+      before.push_back({components[0]->Eval(p.x, p.y, p.z), components[1]->Eval(p.x, p.y, p.z), components[2]->Eval(p.x, p.y, p.z)});
+    }
+
+    VectorField field(components[0], components[1], components[2]);
+    for (size_t point = 0; point < points.size(); ++point) {
+      Vec3 p = points[point];
+      Vec3 passed = {components[0]->Eval(p.x, p.y, p.z), components[1]->Eval(p.x, p.y, p.z), components[2]->Eval(p.x, p.y, p.z)};
+      Vec3 interned = field.EvalTree(p.x, p.y, p.z);
+      Vec3 compiled = field.Eval(p.x, p.y, p.z);
+      if (!Identical(passed, before[point]) || !Identical(interned, before[point]) || !Identical(compiled, before[point])) {
+        Fail("intern", name + " gives " + VecString(before[point]) + " before interning, then " + VecString(passed) + ", " +
+                       VecString(interned) + " interned and " + VecString(compiled) + " compiled");
+        break;
+      }
+    }
+  }
+}
+
+// Compares the bytecode evaluation of random fields and their curls with
+// the tree walk. Both take the same operations in the same order, clamped
+// quotients included, so they must agree to the bit at every point.
+static void CheckEval(size_t numFields) {
+  mt19937 random(3);
+  uniform_real_distribution<float> coordinate(-2, 2);
+  for (size_t n = 0; n < numFields; ++n) {
+    shared_ptr<ExprArena> arena = make_shared<ExprArena>();
+    ExprArena::Scope scope(arena.get());
+    PrecedenceParser parser(LexMode::MultiVariable);
+    string strs[3];
+    Expr *components[3];
+    for (int c = 0; c < 3; ++c) {
+      strs[c] = Generate(random, random() % 16 + 1);
+      components[c] = parser.Parse(strs[c]);
+      if (!components[c]) {
+        Fail("eval", "could not parse " + strs[c]);
+        return;
+      }
+    }
+    string name = "(" + strs[0] + ", " + strs[1] + ", " + strs[2] + ")";
+    VectorField field(components[0], components[1], components[2], arena);
+    unique_ptr<VectorField> curl(field.Curl(CurlMode::Symbolic));
+    for (int point = 0; point < 8; ++point) {
+      float x = coordinate(random), y = coordinate(random), z = coordinate(random);
+      Vec3 expected = field.EvalTree(x, y, z);
+      Vec3 actual = field.Eval(x, y, z);
+      if (!Identical(expected, actual)) {
+        Fail("eval", "Eval of " + name + " gives " + VecString(actual) + " instead of " + VecString(expected));
+        break;
+      }
+      expected = curl->EvalTree(x, y, z);
+      actual = curl->Eval(x, y, z);
+      if (!Identical(expected, actual)) {
+        Fail("eval", "Eval of the curl of " + name + " gives " + VecString(actual) + " instead of " + VecString(expected));
+        break;
+      }
+    }
+  }
+}
+
+static bool Identical(const vector<Vec3> &a, const vector<Vec3> &b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (!Identical(a[i], b[i])) return false;
+  }
+  return true;
+}
+
+// MinMaxLengths and TraceStreamlines promise the same result for any
+// thread count. Runs both on random fields on the calling thread only and
+// on the whole shared pool, and compares the results bit for bit.
+static void CheckThreads(size_t numFields) {
+  mt19937 random(7);
+  StreamlineOptions options;
+  options.Bounds = {2, 2, 2};
+  options.MaxPoints = 100;
+  vector<Vec3> seeds = Seeds::Grid({-1.5f, -1.5f, -1.5f}, {1.5f, 1.5f, 1.5f}, 3, 3, 3);
+  for (size_t n = 0; n < numFields; ++n) {
+    shared_ptr<ExprArena> arena = make_shared<ExprArena>();
+    ExprArena::Scope scope(arena.get());
+    PrecedenceParser parser(LexMode::MultiVariable);
+    string strs[3];
+    Expr *components[3];
+    for (int c = 0; c < 3; ++c) {
+      strs[c] = Generate(random, random() % 8 + 1);
+      components[c] = parser.Parse(strs[c]);
+    }
+    string name = "(" + strs[0] + ", " + strs[1] + ", " + strs[2] + ")";
+    VectorField field(components[0], components[1], components[2], arena);
+
+    float minSerial, maxSerial, minParallel, maxParallel;
+    field.MinMaxLengths(2, 2, 2, 0.25f, minSerial, maxSerial, 1);
+    field.MinMaxLengths(2, 2, 2, 0.25f, minParallel, maxParallel, 0);
+    if (!Identical(minSerial, minParallel) || !Identical(maxSerial, maxParallel)) {
+      Fail("threads", "MinMaxLengths of " + name + " gives " + to_string(minParallel) + " " + to_string(maxParallel) +
+                      " on the pool instead of " + to_string(minSerial) + " " + to_string(maxSerial));
+    }
+
+    for (Integrator method : {Integrator::RK4, Integrator::DormandPrince}) {
+      options.Method = method;
+      Streamlines serial, parallel;
+      TraceStreamlines(field, seeds, options, serial, 1);
+      TraceStreamlines(field, seeds, options, parallel, 0);
+      bool same = serial.Offsets == parallel.Offsets && Identical(serial.Points, parallel.Points) &&
+                  serial.Speeds.size() == parallel.Speeds.size();
+      for (size_t i = 0; same && i < serial.Speeds.size(); ++i) {
+        same = Identical(serial.Speeds[i], parallel.Speeds[i]);
+      }
+      if (!same) {
+        Fail("threads", string(method == Integrator::RK4 ? "RK4" : "Dormand-Prince") + " streamlines of " + name + " differ on the pool");
+      }
+    }
+  }
+}
+
+// Distance in units in the last place between two finite floats of any sign.
+static int64_t UlpDistance(float a, float b) {
+  int32_t ia, ib;
+  memcpy(&ia, &a, sizeof(float));
+  memcpy(&ib, &b, sizeof(float));
+  int64_t oa = ia < 0 ? (int64_t)INT32_MIN - ia : ia;
+  int64_t ob = ib < 0 ? (int64_t)INT32_MIN - ib : ib;
+  return oa > ob ? oa - ob : ob - oa;
+}
+
+// Evaluates program at every point with Simd::EvalBatch under the active
+// instruction set, and calls compare with each result and the one of
+// Program::Eval. The point count is not a multiple of any vector width, so
+// the tail is covered too.
+static void CompareSimd(const Program &program, const vector<float> &xs, const vector<float> &ys, function<void(float x, float y, float simd, float scalar)> compare) {
+  size_t n = xs.size();
+  vector<float> zs(n, 0.5f), results(n);
+  float *outputs[1] = {results.data()};
+  Simd::EvalBatch(program, xs.data(), ys.data(), zs.data(), n, outputs);
+  for (size_t i = 0; i < n; ++i) {
+    float scalar;
+    program.Eval(xs[i], ys[i], zs[i], &scalar);
+    compare(xs[i], ys[i], results[i], scalar);
+  }
+}
+
+// Runs Simd::EvalBatch under every instruction set the CPU supports
+// against Program::Eval: Neg, Add, Sub, Mult and Div must be bit-identical,
+// and Sin, Cos, Log and Pow within the bounds documented in SimdKernels.h.
+static void CheckSimd(size_t numPoints) {
+  ExprArena arena;
+  ExprArena::Scope scope(&arena);
+  PrecedenceParser parser(LexMode::MultiVariable);
+  Expr *x = new X(), *y = new Y();
+  Program sinProgram = Compile({new Sin(x)});
+  Program cosProgram = Compile({new Cos(x)});
+  Program logProgram = Compile({new Log(x)});
+  Program powProgram = Compile({new Pow(x, y)});
+
+  for (Simd::Isa isa : {Simd::Isa::Scalar, Simd::Isa::SSE2, Simd::Isa::NEON, Simd::Isa::AVX2}) {
+    Simd::SetIsa(isa);
+    if (Simd::ActiveIsa() != isa) continue;
+    string name = Simd::IsaName(isa);
+    // Isa::Scalar runs Program::EvalBatch, which calls the same functions.
+    bool exact = isa == Simd::Isa::Scalar;
+    mt19937 random(5);
+    size_t failures = numFailures;
+    auto report = [&](const string &what) {
+      if (numFailures - failures < 5) Fail("simd", name + ": " + what);
+      else ++numFailures;
+    };
+
+    // Arithmetic, clamped quotients included.
+    uniform_real_distribution<float> coordinate(-2, 2);
+    vector<float> xs(numPoints), ys(numPoints);
+    for (size_t i = 0; i < numPoints; ++i) {
+      xs[i] = coordinate(random);
+      ys[i] = coordinate(random);
+    }
+    for (int n = 0; n < 200; ++n) {
+      string str;
+      do {
+        str = Generate(random, random() % 12 + 1);
+      } while (str.find_first_of("^sc") != string::npos);
+      Expr *E = parser.Parse(str);
+      Program program = Compile({new Neg(E)});
+      CompareSimd(program, xs, ys, [&](float x, float y, float simd, float scalar) {
+        if (!Identical(simd, scalar)) {
+          report("-(" + str + ") at " + to_string(x) + " " + to_string(y) + " gives " + to_string(simd) + " instead of " + to_string(scalar));
+        }
+      });
+    }
+
+    // sin and cos, over the range of the polynomial and past it.
+    uniform_real_distribution<float> angle(-8192, 8192), small(-4, 4), large(-1e6f, 1e6f);
+    for (size_t i = 0; i < numPoints; ++i) {
+      xs[i] = i % 3 == 0 ? angle(random) : i % 3 == 1 ? small(random) : large(random);
+    }
+    for (Program *program : {&sinProgram, &cosProgram}) {
+      string op = program == &sinProgram ? "sin" : "cos";
+      CompareSimd(*program, xs, ys, [&](float x, float, float simd, float scalar) {
+        bool ok = fabs(x) <= 8192 && !exact ? UlpDistance(simd, scalar) <= 2 || fabs(simd - scalar) <= 1e-10f : Identical(simd, scalar);
+        if (!ok) report(op + "(" + to_string(x) + ") gives " + to_string(simd) + " instead of " + to_string(scalar));
+      });
+    }
+
+    // log of positive normal numbers of every exponent, and of the rest.
+    uniform_real_distribution<float> mantissa(1, 2);
+    for (size_t i = 0; i < numPoints; ++i) {
+      switch (i % 8) {
+        case 0: xs[i] = -mantissa(random); break;
+        case 1: xs[i] = i % 16 == 1 ? 0.0f : 1e-40f; break;
+        default: xs[i] = ldexpf(mantissa(random), (int)(random() % 254) - 126);
+      }
+    }
+    CompareSimd(logProgram, xs, ys, [&](float x, float, float simd, float scalar) {
+      bool ok = isnormal(x) && x > 0 && !exact ? UlpDistance(simd, scalar) <= 1 : Identical(simd, scalar);
+      if (!ok) report("log(" + to_string(x) + ") gives " + to_string(simd) + " instead of " + to_string(scalar));
+    });
+
+    // pow with integer and fractional exponents, and special operands.
+    uniform_real_distribution<float> base(0.001f, 100), exponent(-8, 8);
+    for (size_t i = 0; i < numPoints; ++i) {
+      xs[i] = i % 4 == 0 ? -base(random) : base(random);
+      switch (i % 5) {
+        case 0: ys[i] = (float)((int)(random() % 33) - 16); break;
+        case 1: ys[i] = 2; break;
+        default: ys[i] = exponent(random);
+      }
+      if (i % 97 == 0) xs[i] = 0;
+      if (i % 89 == 0) ys[i] = INFINITY;
+    }
+    CompareSimd(powProgram, xs, ys, [&](float x, float y, float simd, float scalar) {
+      bool special = x == 0 || !isfinite(x) || !isfinite(y) || !isfinite(scalar) || !isnormal(scalar);
+      bool ok;
+      if (special || exact) {
+        ok = Identical(simd, scalar);
+      } else if (y == floorf(y) && fabs(y) <= 16) {
+        // x^2 is exact, which powf need not be.
+        ok = UlpDistance(simd, scalar) <= fabs(y) && (y != 2 || Identical(simd, x * x));
+      } else {
+        ok = UlpDistance(simd, scalar) <= 4 + 2 * fabs(y * log(fabs(x)));
+      }
+      if (!ok) report("pow(" + to_string(x) + ", " + to_string(y) + ") gives " + to_string(simd) + " instead of " + to_string(scalar));
+    });
+  }
+  Simd::SetIsa(Simd::BestIsa());
+}
+
+struct Check {
+  const char *Name;
+  function<void()> Run;
+};
+
+static void Usage(const vector<Check> &checks) {
+  fprintf(stderr, "usage: Checks [--check name]...\n  checks:");
+  for (const Check &check : checks) fprintf(stderr, " %s", check.Name);
+  fprintf(stderr, "\n  all checks run by default\n");
+}
+
+int main(int argc, char **argv) {
+  vector<Check> checks = {
+    {"simplify", [] { CheckSimplify(2000); CheckSimplifyNaN(); }},
+    {"curl", [] { CheckCurl(500); }},
+    {"eval", [] { CheckEval(1000); }},
+    {"intern", [] { CheckIntern(1000); }},
+    {"parser", [] { CheckParser(2000); }},
+    {"lexer", CheckLexer},
+    {"simd", [] { CheckSimd(4099); }},
+    {"threads", [] { CheckThreads(100); }}
+  };
+
+  vector<string> selected;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--check") && i + 1 < argc) {
+      selected.push_back(argv[++i]);
+    } else {
+      Usage(checks);
+      return 1;
+    }
+  }
+
+  for (const Check &check : checks) {
+    if (!selected.empty() && find(selected.begin(), selected.end(), check.Name) == selected.end()) continue;
+    int before = numFailures;
+    check.Run();
+    printf("%s %s\n", numFailures == before ? "ok" : "FAIL", check.Name);
+  }
+  return numFailures == 0 ? 0 : 1;
+}
@@ -1,4 +1,15 @@
 #include "Expr.h"
+#include <type_traits>
+
+using namespace Expression;
+
+// Arenas free nodes without running destructors.
+template <typename... Nodes>
+constexpr bool TriviallyDestructible() {
+  return (is_trivially_destructible<Nodes>::value && ...);
+}
+static_assert(TriviallyDestructible<Val, T, X, Y, Z, Neg, Add, Sub, Mult, Div, Pow, Sin, Cos, Log>(),
+              "Expr nodes must be trivially destructible");
 
 extern string Expression::Precision(float f, int precision) {
   std::stringstream stream;
@@ -9,4 +20,45 @@ extern string Expression::Precision(float f, int precision) {
 
 extern Expression::Expr *Expression::CreateCos(Expr *Child) {
   return new Expression::Cos(Child);
+}
+
+extern size_t Expression::ChildSlots(Expr *E, Expr **&first, Expr **&second) {
+  first = nullptr;
+  second = nullptr;
+  switch (E->Kind) {
+    case ExprKind::NegKind:
+      first = &static_cast<Neg *>(E)->Child;
+      return 1;
+    case ExprKind::SinKind:
+      first = &static_cast<Sin *>(E)->Child;
+      return 1;
+    case ExprKind::CosKind:
+      first = &static_cast<Cos *>(E)->Child;
+      return 1;
+    case ExprKind::LogKind:
+      first = &static_cast<Log *>(E)->Child;
+      return 1;
+    case ExprKind::AddKind:
+      first = &static_cast<Add *>(E)->Left;
+      second = &static_cast<Add *>(E)->Right;
+      return 2;
+    case ExprKind::SubKind:
+      first = &static_cast<Sub *>(E)->Left;
+      second = &static_cast<Sub *>(E)->Right;
+      return 2;
+    case ExprKind::MultKind:
+      first = &static_cast<Mult *>(E)->Left;
+      second = &static_cast<Mult *>(E)->Right;
+      return 2;
+    case ExprKind::DivKind:
+      first = &static_cast<Div *>(E)->Left;
+      second = &static_cast<Div *>(E)->Right;
+      return 2;
+    case ExprKind::PowKind:
+      first = &static_cast<Pow *>(E)->Left;
+      second = &static_cast<Pow *>(E)->Right;
+      return 2;
+    default:
+      return 0;
+  }
 }
\ No newline at end of file
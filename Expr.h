@@ -4,6 +4,7 @@
 #include <math.h>
 #include <iomanip>
 #include <sstream>
+#include "ExprArena.h"
 
 using namespace std;
 
@@ -30,6 +31,11 @@ namespace Expression {
   class Expr {
   public:
     ExprKind Kind;
+    // Nodes live in an ExprArena and are freed with it, never individually.
+    static void *operator new(size_t size) {
+      return ExprArena::Current()->Allocate(size);
+    }
+    static void operator delete(void *) {}
     virtual bool IncludeParens() { return false; }
     virtual string ToString() = 0;
     virtual float Eval(float x, float y, float z) = 0;
@@ -46,6 +52,9 @@ namespace Expression {
   };
 
   extern Expr *CreateCos(Expr *Child);
+  // Points first and second at the child pointer fields of E (at most two)
+  // and returns how many children E has. Unused slots are set to nullptr.
+  extern size_t ChildSlots(Expr *E, Expr **&first, Expr **&second);
   
   class Val : public Expr {
   public:
@@ -67,10 +76,10 @@ namespace Expression {
       return true;
     }
     bool IsZero() {
-      return (int)V == 0;
+      return V == 0;
     }
     bool IsOne() {
-      return (int)V == 1;
+      return V == 1;
     }
 
     // Constant rule: dc/dx = 0
@@ -236,7 +245,7 @@ namespace Expression {
       }
       if (SubExpr->Kind == ExprKind::NegKind) {
         // --e == e
-        return SubExpr;
+        return static_cast<Neg *>(SubExpr)->Child;
       }
       return new Neg(SubExpr);
     }
@@ -450,11 +459,12 @@ namespace Expression {
       Expr *L = Left->Simplify();
       Expr *R = Right->Simplify();
       if (L->Kind == ExprKind::ValKind && R->Kind == ExprKind::ValKind) {
-        // Simplify multiplication of constants into a single constant
+        // Simplify division of constants into a single constant, clamping
+        // like Eval does
         Val *V1 = static_cast<Val *>(L);
         Val *V2 = static_cast<Val *>(R);
-        float value = 1000000;
-        if ((int)V2->V != 0)
+        float value = 1000000000.0;
+        if (V2->V > 0.00001)
           value = V1->V / V2->V;
         int precision = 0;
         if (V1->P > precision) {
@@ -493,13 +503,17 @@ namespace Expression {
       return log(Child->Eval(x, y, z));
     }
 
-    // Natural log rule: ln(x)' = 1/x
-    Expr *Derivative(char ) {
-      return new Div(new Val(1, 0), Child);
+    // Natural log rule with the chain rule: ln(f)' = f'/f
+    Expr *Derivative(char wrt) {
+      return new Div(Child->Derivative(wrt), Child);
     }
 
     Expr *Simplify() {
       Expr *SubExpr = Child->Simplify();
+      float subVal;
+      if (SubExpr->NumericValue(subVal)) {
+        return new Val(log(subVal), 2);
+      }
       return new Log(SubExpr);
     }
 
@@ -536,7 +550,15 @@ namespace Expression {
       Expr *L = Left->Simplify();
       Expr *R = Right->Simplify();
       if (L->Kind == ExprKind::ValKind && R->Kind == ExprKind::ValKind) {
-        // TODO: simplify exponentiation of constants
+        // Simplify exponentiation of constants into a single constant
+        Val *V1 = static_cast<Val *>(L);
+        Val *V2 = static_cast<Val *>(R);
+        float value = pow(V1->V, V2->V);
+        int precision = V1->P;
+        if (value != floor(value) && precision < 2) {
+          precision = 2;
+        }
+        return new Val(value, precision);
       }
       return new Pow(L, R);
     }
@@ -560,13 +582,17 @@ namespace Expression {
       return sin(Child->Eval(x, y, z));
     }
 
-    // Sine rule: sin(x)' = cos(x)
-    Expr *Derivative(char ) {
-      return CreateCos(Child);
+    // Sine rule with the chain rule: sin(f)' = cos(f) * f'
+    Expr *Derivative(char wrt) {
+      return new Mult(CreateCos(Child), Child->Derivative(wrt));
     }
 
     Expr *Simplify() {
       Expr *SubExpr = Child->Simplify();
+      float subVal;
+      if (SubExpr->NumericValue(subVal)) {
+        return new Val(sin(subVal), 2);
+      }
       return new Sin(SubExpr);
     }
 
@@ -589,13 +615,17 @@ namespace Expression {
       return cos(Child->Eval(x, y, z));
     }
 
-    // Cosine rule: cos(x)' = -sin(x)
-    Expr *Derivative(char ) {
-      return new Neg(new Sin(Child));
+    // Cosine rule with the chain rule: cos(f)' = -sin(f) * f'
+    Expr *Derivative(char wrt) {
+      return new Mult(new Neg(new Sin(Child)), Child->Derivative(wrt));
     }
 
     Expr *Simplify() {
       Expr *SubExpr = Child->Simplify();
+      float subVal;
+      if (SubExpr->NumericValue(subVal)) {
+        return new Val(cos(subVal), 2);
+      }
       return new Cos(SubExpr);
     }
 
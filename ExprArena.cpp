@@ -0,0 +1,64 @@
+#include "ExprArena.h"
+#include <stdlib.h>
+#include <new>
+
+using namespace Expression;
+
+static thread_local ExprArena *currentArena = nullptr;
+
+static ExprArena &DefaultArena() {
+  // Never destroyed, since nodes built outside of any scope may be used
+  // until the program exits.
+  static ExprArena *arena = new ExprArena();
+  return *arena;
+}
+
+void *ExprArena::Allocate(size_t size) {
+  const size_t alignment = alignof(max_align_t);
+  size = (size + alignment - 1) & ~(alignment - 1);
+
+  if (size > (size_t)(end - next)) {
+    // Oversized requests get a block of their own; the current block keeps
+    // serving small ones.
+    size_t blockSize = size > BlockSize ? size : BlockSize;
+    char *block = (char *)malloc(blockSize);
+    if (!block) throw bad_alloc();
+    blocks.push_back(block);
+    if (blockSize > BlockSize) {
+      ++numAllocations;
+      bytesAllocated += size;
+      return block;
+    }
+    next = block;
+    end = block + blockSize;
+  }
+
+  void *result = next;
+  next += size;
+  ++numAllocations;
+  bytesAllocated += size;
+  return result;
+}
+
+void ExprArena::Release() {
+  for (char *block : blocks) {
+    free(block);
+  }
+  blocks.clear();
+  next = nullptr;
+  end = nullptr;
+  numAllocations = 0;
+  bytesAllocated = 0;
+}
+
+ExprArena *ExprArena::Current() {
+  return currentArena ? currentArena : &DefaultArena();
+}
+
+ExprArena::Scope::Scope(ExprArena *arena) : previous(currentArena) {
+  currentArena = arena;
+}
+
+ExprArena::Scope::~Scope() {
+  currentArena = previous;
+}
@@ -0,0 +1,60 @@
+#ifndef VECTORFIELD_EXPRARENA
+#define VECTORFIELD_EXPRARENA
+#include <stddef.h>
+#include <vector>
+
+using namespace std;
+
+namespace Expression {
+  // Bump allocator that owns Expr nodes. Every Expr is allocated from the
+  // arena that is current on the allocating thread (see Scope), or from a
+  // process-wide default arena when there is none. Nodes are never deleted
+  // one at a time; destroying or releasing an arena frees all of its nodes
+  // at once, so everything built from them (derivatives, curls, simplified
+  // forms) must be allocated in the same arena or one that outlives it.
+  //
+  // An arena is not thread-safe, but each thread has its own current arena.
+  class ExprArena {
+  public:
+    ExprArena() {}
+    ~ExprArena() { Release(); }
+    ExprArena(const ExprArena &) = delete;
+    ExprArena &operator=(const ExprArena &) = delete;
+
+    void *Allocate(size_t size);
+    // Frees every allocation at once. Pointers into the arena are invalid
+    // afterwards, but the arena itself can be reused.
+    void Release();
+
+    size_t NumAllocations() const { return numAllocations; }
+    size_t BytesAllocated() const { return bytesAllocated; }
+
+    // Arena used for new Expr nodes on this thread.
+    static ExprArena *Current();
+
+    // Makes an arena current on this thread for the lifetime of the scope.
+    // Scopes nest; the previous arena is restored on exit. A null arena
+    // selects the default arena.
+    class Scope {
+    public:
+      Scope(ExprArena *arena);
+      ~Scope();
+      Scope(const Scope &) = delete;
+      Scope &operator=(const Scope &) = delete;
+
+    private:
+      ExprArena *previous;
+    };
+
+  private:
+    static const size_t BlockSize = 16 * 1024;
+
+    vector<char *> blocks;
+    char *next = nullptr;
+    char *end = nullptr;
+    size_t numAllocations = 0;
+    size_t bytesAllocated = 0;
+  };
+}
+
+#endif
@@ -0,0 +1,128 @@
+#include "FieldSampler.h"
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+// A cell of the octree. Cells are placed on an integer lattice fine enough
+// to hold the centers of the smallest ones, so shared corners have the same
+// coordinates and are evaluated once.
+struct OctreeCell {
+  int64_t I, J, K;
+  // Side in lattice units.
+  int64_t Size;
+  int Depth;
+  // Above 1 if the cell is to be split.
+  float Error;
+
+  bool operator<(const OctreeCell &other) const {
+    return Error < other.Error;
+  }
+};
+
+void SampleFieldOctree(VectorField &field, Vec3 range, const OctreeSampling &options, FieldSamples &samples) {
+  samples.Points.clear();
+  samples.Values.clear();
+  samples.Sizes.clear();
+  samples.Evaluations = 0;
+
+  int maxDepth = MathUtils::Clamp(options.MaxDepth, 0, 16);
+  int64_t baseSize = (int64_t)2 << maxDepth;
+  int64_t baseX = max(options.BaseX, 1), baseY = max(options.BaseY, 1), baseZ = max(options.BaseZ, 1);
+  int64_t nx = baseX * baseSize, ny = baseY * baseSize, nz = baseZ * baseSize;
+
+  unordered_map<uint64_t, Vec3> values;
+  auto position = [&](int64_t i, int64_t j, int64_t k) {
+    Vec3 p = {range.x * (2.0f * i / nx - 1), range.y * (2.0f * j / ny - 1), range.z * (2.0f * k / nz - 1)};
+    return p;
+  };
+  auto valueAt = [&](int64_t i, int64_t j, int64_t k) {
+    uint64_t key = ((uint64_t)i * (ny + 1) + j) * (nz + 1) + k;
+    auto it = values.find(key);
+    if (it != values.end()) {
+      return it->second;
+    }
+    Vec3 p = position(i, j, k);
+    Vec3 v = field.Eval(p.x, p.y, p.z);
+    ++samples.Evaluations;
+    values[key] = v;
+    return v;
+  };
+
+  // Largest change from the center to a corner, relative to the thresholds.
+  float lengthScale = 0;
+  auto error = [&](const OctreeCell &cell) {
+    int64_t half = cell.Size / 2;
+    Vec3 center = valueAt(cell.I + half, cell.J + half, cell.K + half);
+    float centerLength = Vector::Length(center);
+    float result = 0;
+    for (int corner = 0; corner < 8; ++corner) {
+      Vec3 v = valueAt(cell.I + (corner & 1 ? cell.Size : 0), cell.J + (corner & 2 ? cell.Size : 0), cell.K + (corner & 4 ? cell.Size : 0));
+      float turn = Vector::Angle(center, v) / options.MaxTurn;
+      float change = fabsf(Vector::Length(v) - centerLength) / (options.MaxLengthChange * lengthScale);
+      // Comparisons with NaN fail, so NaN values never split a cell, and
+      // neither do infinite lengths.
+      if (turn > result) result = turn;
+      if (change > result && !isinf(change)) result = change;
+    }
+    return result;
+  };
+
+  vector<OctreeCell> cells;
+  for (int64_t i = 0; i < baseX; ++i) {
+    for (int64_t j = 0; j < baseY; ++j) {
+      for (int64_t k = 0; k < baseZ; ++k) {
+        OctreeCell cell = {i * baseSize, j * baseSize, k * baseSize, baseSize, 0, 0};
+        Vec3 center = valueAt(cell.I + baseSize / 2, cell.J + baseSize / 2, cell.K + baseSize / 2);
+        lengthScale = fmaxf(lengthScale, Vector::Length(center));
+        cells.push_back(cell);
+      }
+    }
+  }
+  if (!(lengthScale > 0) || isinf(lengthScale)) {
+    lengthScale = 1;
+  }
+
+  vector<OctreeCell> leaves;
+  priority_queue<OctreeCell> toSplit;
+  auto add = [&](OctreeCell cell) {
+    if (cell.Depth < maxDepth) {
+      cell.Error = error(cell);
+      if (cell.Error > 1) {
+        toSplit.push(cell);
+        return;
+      }
+    }
+    leaves.push_back(cell);
+  };
+  for (const OctreeCell &cell : cells) {
+    add(cell);
+  }
+
+  // A split turns one leaf into eight.
+  size_t numLeaves = cells.size();
+  while (!toSplit.empty() && numLeaves + 7 <= options.MaxPoints) {
+    OctreeCell cell = toSplit.top();
+    toSplit.pop();
+    int64_t half = cell.Size / 2;
+    for (int child = 0; child < 8; ++child) {
+      add({cell.I + (child & 1 ? half : 0), cell.J + (child & 2 ? half : 0), cell.K + (child & 4 ? half : 0), half, cell.Depth + 1, 0});
+    }
+    numLeaves += 7;
+  }
+  while (!toSplit.empty()) {
+    leaves.push_back(toSplit.top());
+    toSplit.pop();
+  }
+
+  samples.Points.reserve(leaves.size());
+  samples.Values.reserve(leaves.size());
+  samples.Sizes.reserve(leaves.size());
+  for (const OctreeCell &leaf : leaves) {
+    int64_t half = leaf.Size / 2;
+    samples.Points.push_back(position(leaf.I + half, leaf.J + half, leaf.K + half));
+    samples.Values.push_back(valueAt(leaf.I + half, leaf.J + half, leaf.K + half));
+    samples.Sizes.push_back((float)leaf.Size / baseSize);
+  }
+}
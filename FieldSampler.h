@@ -0,0 +1,42 @@
+#ifndef VECTORFIELD_FIELDSAMPLER
+#define VECTORFIELD_FIELDSAMPLER
+#include "VectorField.h"
+#include "Utils/MathUtils.h"
+#include <stddef.h>
+#include <vector>
+
+using namespace std;
+
+struct OctreeSampling {
+  // Cells of the coarsest level along each axis.
+  int BaseX = 6;
+  int BaseY = 6;
+  int BaseZ = 2;
+  // A cell is split in eight when the field at one of its corners turns
+  // from the field at its center by more than MaxTurn radians, or differs in
+  // length by more than MaxLengthChange times the largest length of the
+  // coarsest level.
+  float MaxTurn = 0.5f;
+  float MaxLengthChange = 0.2f;
+  // Leaves at most, and levels of splitting below the coarsest one.
+  size_t MaxPoints = 600;
+  int MaxDepth = 3;
+};
+
+// One sample at the center of each leaf of the octree.
+struct FieldSamples {
+  vector<Vec3> Points;
+  vector<Vec3> Values;
+  // Size of each leaf relative to a cell of the coarsest level: 1, 1/2,
+  // 1/4 and so on.
+  vector<float> Sizes;
+  // Evaluations of the field, counting corners shared by cells once.
+  size_t Evaluations = 0;
+};
+
+// Samples field over [-range, range], refining where it varies the most
+// first until no cell varies beyond the thresholds or the point budget is
+// spent.
+extern void SampleFieldOctree(VectorField &field, Vec3 range, const OctreeSampling &options, FieldSamples &samples);
+
+#endif
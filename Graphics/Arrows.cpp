@@ -0,0 +1,212 @@
+#include "Arrows.h"
+#include "Profiler.h"
+#include <math.h>
+
+ArrowShape ArrowGraphic::Shape(Vec3 start, Vec3 end, float maxConeRadius) {
+  ArrowShape shape;
+  Vec3 vector = Vector::GetVector(start, end);
+  float vecLen = Vector::Length(vector);
+  shape.Start = start;
+  shape.Direction = vecLen > 0 ? Vector::Normalize(vector) : Vec3{0, 0, 1};
+  shape.ConeLength = MathUtils::Clamp(0.32 * vecLen, 0.05, 0.22);
+  float shaftLength = vecLen - shape.ConeLength;
+  shape.ShaftEnd = {start.x + shaftLength * shape.Direction.x,
+                    start.y + shaftLength * shape.Direction.y,
+                    start.z + shaftLength * shape.Direction.z};
+  shape.ConeRadius = MathUtils::Clamp(0.32 * shape.ConeLength, 0.02, maxConeRadius);
+  return shape;
+}
+
+// Row-major rotation taking the z axis to the unit vector d.
+static void RotationTo(Vec3 d, float R[9]) {
+  // Axis z x d, whose length is the sine of the angle.
+  float kx = -d.y, ky = d.x;
+  float s = sqrt(kx * kx + ky * ky);
+  float c = d.z;
+  if (s < 0.0000001f) {
+    // Along the z axis: either no rotation or a half turn about x.
+    float flip = c > 0 ? 1 : -1;
+    float identity[9] = {1, 0, 0, 0, flip, 0, 0, 0, flip};
+    for (int i = 0; i < 9; ++i) R[i] = identity[i];
+    return;
+  }
+  kx /= s;
+  ky /= s;
+  float t = 1 - c;
+  R[0] = c + t * kx * kx; R[1] = t * kx * ky;     R[2] = s * ky;
+  R[3] = t * kx * ky;     R[4] = c + t * ky * ky; R[5] = -s * kx;
+  R[6] = -s * ky;         R[7] = s * kx;          R[8] = c;
+}
+
+static void AppendVertex(vector<float> &vertices, const float R[9], Vec3 base, Vec3 p, Vec3 n, Color color) {
+  vertices.push_back(base.x + R[0] * p.x + R[1] * p.y + R[2] * p.z);
+  vertices.push_back(base.y + R[3] * p.x + R[4] * p.y + R[5] * p.z);
+  vertices.push_back(base.z + R[6] * p.x + R[7] * p.y + R[8] * p.z);
+  vertices.push_back(R[0] * n.x + R[1] * n.y + R[2] * n.z);
+  vertices.push_back(R[3] * n.x + R[4] * n.y + R[5] * n.z);
+  vertices.push_back(R[6] * n.x + R[7] * n.y + R[8] * n.z);
+  vertices.push_back(color.r);
+  vertices.push_back(color.g);
+  vertices.push_back(color.b);
+  vertices.push_back(color.a);
+}
+
+void ArrowGraphic::AppendCone(vector<float> &vertices, Vec3 base, Vec3 direction, float radius, float length, Color color) {
+  float R[9];
+  RotationTo(direction, R);
+  Vec3 apex = {0, 0, length};
+  Vec3 center = {0, 0, 0};
+  // Like gluDisk, the base faces along the cone.
+  Vec3 up = {0, 0, 1};
+  for (int i = 0; i < coneSlices; ++i) {
+    float a0 = 2 * M_PI * i / coneSlices;
+    float a1 = 2 * M_PI * (i + 1) / coneSlices;
+    float am = 0.5f * (a0 + a1);
+    Vec3 p0 = {radius * cosf(a0), radius * sinf(a0), 0};
+    Vec3 p1 = {radius * cosf(a1), radius * sinf(a1), 0};
+    // The side normal at angle a is (length cos a, length sin a, radius).
+    Vec3 n0 = Vector::Normalize({length * cosf(a0), length * sinf(a0), radius});
+    Vec3 n1 = Vector::Normalize({length * cosf(a1), length * sinf(a1), radius});
+    Vec3 nm = Vector::Normalize({length * cosf(am), length * sinf(am), radius});
+    AppendVertex(vertices, R, base, p0, n0, color);
+    AppendVertex(vertices, R, base, p1, n1, color);
+    AppendVertex(vertices, R, base, apex, nm, color);
+    AppendVertex(vertices, R, base, center, up, color);
+    AppendVertex(vertices, R, base, p1, up, color);
+    AppendVertex(vertices, R, base, p0, up, color);
+  }
+}
+
+void ArrowRenderer::Initialize() {
+  // A cone of radius and length 1 along z, scaled for each arrow. The side
+  // normals of a unit cone stay correct under that scaling once GL
+  // renormalizes them (GL_NORMALIZE).
+  vector<float> vertices;
+  ArrowGraphic::AppendCone(vertices, {0, 0, 0}, {0, 0, 1}, 1, 1, {1, 1, 1, 1});
+  numConeVertices = vertices.size() / 10;
+  cone.create();
+  cone.bind();
+  cone.allocate(vertices.data(), vertices.size() * sizeof(float));
+  cone.release();
+}
+
+void ArrowRenderer::Destroy() {
+  cone.destroy();
+}
+
+void ArrowRenderer::Draw(Vec3 start, Vec3 end, Color color, float thickness, float maxConeRadius) {
+  ArrowShape shape = ArrowGraphic::Shape(start, end, maxConeRadius);
+
+  glColor4f(color.r, color.g, color.b, color.a);
+  glLineWidth(thickness);
+  glNormal3f(0, 0, 1);
+  glBegin(GL_LINES);
+    glVertex3f(shape.Start.x, shape.Start.y, shape.Start.z);
+    glVertex3f(shape.ShaftEnd.x, shape.ShaftEnd.y, shape.ShaftEnd.z);
+  glEnd();
+
+  float R[9];
+  RotationTo(shape.Direction, R);
+  GLfloat matrix[16] = {
+    R[0], R[3], R[6], 0,
+    R[1], R[4], R[7], 0,
+    R[2], R[5], R[8], 0,
+    shape.ShaftEnd.x, shape.ShaftEnd.y, shape.ShaftEnd.z, 1
+  };
+  glPushMatrix();
+  glMultMatrixf(matrix);
+  glScalef(shape.ConeRadius, shape.ConeRadius, shape.ConeLength);
+
+  cone.bind();
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_NORMAL_ARRAY);
+  glVertexPointer(3, GL_FLOAT, 10 * sizeof(float), (void *)0);
+  glNormalPointer(GL_FLOAT, 10 * sizeof(float), (void *)(3 * sizeof(float)));
+  glDrawArrays(GL_TRIANGLES, 0, numConeVertices);
+  // The shaft and the cone.
+  Profiler::Shared().Count(ProfileCounter::DrawCalls, 2);
+  Profiler::Shared().Count(ProfileCounter::Arrows, 1);
+  glDisableClientState(GL_NORMAL_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  cone.release();
+
+  glPopMatrix();
+}
+
+void ArrowBatch::Set(const vector<ArrowShape> &shapes, const vector<Color> &colors) {
+  lines.clear();
+  triangles.clear();
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    const ArrowShape &shape = shapes[i];
+    const Color &color = colors[i];
+    for (Vec3 p : {shape.Start, shape.ShaftEnd}) {
+      lines.insert(lines.end(), {p.x, p.y, p.z, color.r, color.g, color.b, color.a});
+    }
+    ArrowGraphic::AppendCone(triangles, shape.ShaftEnd, shape.Direction, shape.ConeRadius, shape.ConeLength, color);
+  }
+  dirty = true;
+}
+
+void ArrowBatch::Upload(QOpenGLBuffer &buffer, const vector<float> &data) {
+  if (!buffer.isCreated()) {
+    buffer.create();
+  }
+  buffer.bind();
+  buffer.allocate(data.data(), data.size() * sizeof(float));
+  buffer.release();
+}
+
+void ArrowBatch::Draw(float thickness, int count) {
+  ProfileScope profile("ArrowBatch::Draw");
+  if (dirty) {
+    Upload(lineBuffer, lines);
+    Upload(triangleBuffer, triangles);
+    numLineVertices = lines.size() / 7;
+    numTriangleVertices = triangles.size() / 10;
+    // The buffers now hold the only copy.
+    lines = vector<float>();
+    triangles = vector<float>();
+    dirty = false;
+  }
+  // Each arrow is one line and the triangles of one cone.
+  int numArrows = numLineVertices / 2;
+  if (count < 0 || count > numArrows) {
+    count = numArrows;
+  }
+  if (count == 0) {
+    return;
+  }
+  int coneVertices = numTriangleVertices / numArrows;
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+
+  lineBuffer.bind();
+  glLineWidth(thickness);
+  glNormal3f(0, 0, 1);
+  glVertexPointer(3, GL_FLOAT, 7 * sizeof(float), (void *)0);
+  glColorPointer(4, GL_FLOAT, 7 * sizeof(float), (void *)(3 * sizeof(float)));
+  glDrawArrays(GL_LINES, 0, 2 * count);
+  lineBuffer.release();
+
+  triangleBuffer.bind();
+  glEnableClientState(GL_NORMAL_ARRAY);
+  glVertexPointer(3, GL_FLOAT, 10 * sizeof(float), (void *)0);
+  glNormalPointer(GL_FLOAT, 10 * sizeof(float), (void *)(3 * sizeof(float)));
+  glColorPointer(4, GL_FLOAT, 10 * sizeof(float), (void *)(6 * sizeof(float)));
+  glDrawArrays(GL_TRIANGLES, 0, coneVertices * count);
+  Profiler::Shared().Count(ProfileCounter::DrawCalls, 2);
+  Profiler::Shared().Count(ProfileCounter::Arrows, count);
+  glDisableClientState(GL_NORMAL_ARRAY);
+  triangleBuffer.release();
+
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void ArrowBatch::Destroy() {
+  lineBuffer.destroy();
+  triangleBuffer.destroy();
+  numLineVertices = 0;
+  numTriangleVertices = 0;
+}
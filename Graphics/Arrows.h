@@ -0,0 +1,78 @@
+#pragma once
+#ifdef __APPLE__
+/* Defined before OpenGL and GLUT includes to avoid deprecation messages - this doesn't actually work */
+#define GL_SILENCE_DEPRECATION
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <QOpenGLBuffer>
+#include "Utils/MathUtils.h"
+#include <vector>
+
+using namespace std;
+
+// An arrow from Start to End: a shaft from Start to ShaftEnd and a cone
+// from ShaftEnd to End.
+struct ArrowShape {
+  Vec3 Start;
+  Vec3 ShaftEnd;
+  // Unit vector from Start to End.
+  Vec3 Direction;
+  float ConeLength;
+  float ConeRadius;
+};
+
+namespace ArrowGraphic {
+  const int coneSlices = 24;
+
+  // The cone is a fixed fraction of the arrow, within limits.
+  ArrowShape Shape(Vec3 start, Vec3 end, float maxConeRadius = 0.07f);
+
+  // Triangles of a cone with a disk at its base, pointing along direction,
+  // as position, normal and color (10 floats per vertex).
+  void AppendCone(vector<float> &vertices, Vec3 base, Vec3 direction, float radius, float length, Color color);
+}
+
+// Draws arrows one at a time, with the shaft as a line and the cone from a
+// mesh that is uploaded once. Initialize and Destroy need a current context.
+class ArrowRenderer {
+public:
+  ArrowRenderer() : cone(QOpenGLBuffer::VertexBuffer) {}
+  void Initialize();
+  void Destroy();
+  void Draw(Vec3 start, Vec3 end, Color color, float thickness, float maxConeRadius = 0.07f);
+
+private:
+  QOpenGLBuffer cone;
+  int numConeVertices = 0;
+};
+
+// A set of arrows baked into two vertex buffers, one with the shafts as
+// lines and one with the cones as triangles, so that the whole set is drawn
+// with two calls. Meant for arrows that stay the same for many frames.
+class ArrowBatch {
+public:
+  ArrowBatch() : lineBuffer(QOpenGLBuffer::VertexBuffer), triangleBuffer(QOpenGLBuffer::VertexBuffer) {}
+
+  // Replaces the arrows. The buffers are filled on the next Draw, so this
+  // does not need a GL context.
+  void Set(const vector<ArrowShape> &shapes, const vector<Color> &colors);
+  // Draws the first count arrows, or all of them.
+  void Draw(float thickness, int count = -1);
+  // Frees the buffers; the context must be current.
+  void Destroy();
+
+private:
+  // Position and color (7 floats) per line vertex.
+  vector<float> lines;
+  // Position, normal and color (10 floats) per triangle vertex.
+  vector<float> triangles;
+  QOpenGLBuffer lineBuffer;
+  QOpenGLBuffer triangleBuffer;
+  bool dirty = false;
+  int numLineVertices = 0;
+  int numTriangleVertices = 0;
+
+  void Upload(QOpenGLBuffer &buffer, const vector<float> &data);
+};
@@ -0,0 +1,116 @@
+#include "Lines.h"
+#include "Profiler.h"
+
+void LineBatch::Add(Vec3 start, Vec3 end, Color color, float thickness) {
+  vector<float> &vertices = lines[thickness];
+  for (Vec3 p : {start, end}) {
+    vertices.insert(vertices.end(), {p.x, p.y, p.z, color.r, color.g, color.b, color.a});
+  }
+  dirty = true;
+}
+
+void LineBatch::AddStrip(const Vec3 *points, const Color *colors, size_t count, float thickness) {
+  vector<float> &vertices = lines[thickness];
+  for (size_t i = 1; i < count; ++i) {
+    for (size_t j : {i - 1, i}) {
+      const Vec3 &p = points[j];
+      const Color &color = colors[j];
+      vertices.insert(vertices.end(), {p.x, p.y, p.z, color.r, color.g, color.b, color.a});
+    }
+  }
+  dirty = true;
+}
+
+void LineBatch::Clear() {
+  lines.clear();
+  dirty = true;
+}
+
+void LineBatch::Draw() {
+  ProfileScope profile("LineBatch::Draw");
+  if (dirty) {
+    vector<float> vertices;
+    ranges.clear();
+    for (const auto &group : lines) {
+      int first = vertices.size() / 7;
+      vertices.insert(vertices.end(), group.second.begin(), group.second.end());
+      ranges.push_back({group.first, first, (int)group.second.size() / 7});
+    }
+    if (!buffer.isCreated()) {
+      buffer.create();
+    }
+    buffer.bind();
+    buffer.allocate(vertices.data(), vertices.size() * sizeof(float));
+    buffer.release();
+    dirty = false;
+  }
+  if (ranges.empty()) {
+    return;
+  }
+
+  buffer.bind();
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+  glNormal3f(0, 0, 1);
+  glVertexPointer(3, GL_FLOAT, 7 * sizeof(float), (void *)0);
+  glColorPointer(4, GL_FLOAT, 7 * sizeof(float), (void *)(3 * sizeof(float)));
+  for (const Range &range : ranges) {
+    glLineWidth(range.Thickness);
+    glDrawArrays(GL_LINES, range.First, range.Count);
+  }
+  Profiler::Shared().Count(ProfileCounter::DrawCalls, ranges.size());
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  buffer.release();
+}
+
+void LineBatch::Destroy() {
+  buffer.destroy();
+  ranges.clear();
+}
+
+void LineStrip::Set(const vector<Vec3> &newPoints) {
+  points.clear();
+  points.reserve(3 * newPoints.size());
+  for (Vec3 p : newPoints) {
+    points.insert(points.end(), {p.x, p.y, p.z});
+  }
+  dirty = true;
+}
+
+void LineStrip::Draw(Color color, float thickness, int count) {
+  if (dirty) {
+    if (!buffer.isCreated()) {
+      buffer.create();
+    }
+    buffer.bind();
+    buffer.allocate(points.data(), points.size() * sizeof(float));
+    buffer.release();
+    numPoints = points.size() / 3;
+    // The buffer now holds the only copy.
+    points = vector<float>();
+    dirty = false;
+  }
+  if (count < 0 || count > numPoints) {
+    count = numPoints;
+  }
+  if (count < 2) {
+    return;
+  }
+
+  buffer.bind();
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glColor4f(color.r, color.g, color.b, color.a);
+  glLineWidth(thickness);
+  glNormal3f(0, 0, 1);
+  glVertexPointer(3, GL_FLOAT, 3 * sizeof(float), (void *)0);
+  glDrawArrays(GL_LINE_STRIP, 0, count);
+  Profiler::Shared().Count(ProfileCounter::DrawCalls, 1);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  buffer.release();
+}
+
+void LineStrip::Destroy() {
+  buffer.destroy();
+  numPoints = 0;
+}
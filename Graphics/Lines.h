@@ -0,0 +1,69 @@
+#pragma once
+#ifdef __APPLE__
+/* Defined before OpenGL and GLUT includes to avoid deprecation messages - this doesn't actually work */
+#define GL_SILENCE_DEPRECATION
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <QOpenGLBuffer>
+#include "Utils/MathUtils.h"
+#include <map>
+#include <vector>
+
+using namespace std;
+
+// Line segments baked into one vertex buffer, for geometry that stays the
+// same for many frames. Segments are grouped by thickness, so the batch is
+// drawn with one call per distinct thickness.
+class LineBatch {
+public:
+  LineBatch() : buffer(QOpenGLBuffer::VertexBuffer) {}
+
+  // Add and Clear only touch memory; the buffer is filled on the next Draw,
+  // so neither needs a GL context.
+  void Add(Vec3 start, Vec3 end, Color color, float thickness);
+  // Adds the segments between consecutive points, each point with its own
+  // color.
+  void AddStrip(const Vec3 *points, const Color *colors, size_t count, float thickness);
+  void Clear();
+  void Draw();
+  // Frees the buffer; the context must be current.
+  void Destroy();
+
+private:
+  // Position and color (7 floats) per vertex, by thickness.
+  map<float, vector<float>> lines;
+  QOpenGLBuffer buffer;
+  bool dirty = false;
+
+  // Vertices drawn with each thickness, in buffer order.
+  struct Range {
+    float Thickness;
+    int First;
+    int Count;
+  };
+  vector<Range> ranges;
+};
+
+// A polyline of one color in a vertex buffer, of which any leading part
+// can be drawn.
+class LineStrip {
+public:
+  LineStrip() : buffer(QOpenGLBuffer::VertexBuffer) {}
+
+  // Replaces the points. The buffer is filled on the next Draw, so this
+  // does not need a GL context.
+  void Set(const vector<Vec3> &points);
+  // Draws the line through the first count points, or all of them.
+  void Draw(Color color, float thickness, int count = -1);
+  // Frees the buffer; the context must be current.
+  void Destroy();
+
+private:
+  // Position (3 floats) per point.
+  vector<float> points;
+  QOpenGLBuffer buffer;
+  bool dirty = false;
+  int numPoints = 0;
+};
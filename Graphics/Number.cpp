@@ -1,6 +1,6 @@
 #include "Number.h"
 
-void NumberGraphic::DrawNumber(string str, float x, float y, float z, Direction dir) {
+void NumberGraphic::AppendNumber(LineBatch &lines, string str, float x, float y, float z, Direction dir) {
   size_t len = str.length();
   bool left = dir == Direction::LToR;
 
@@ -19,10 +19,7 @@ void NumberGraphic::DrawNumber(string str, float x, float y, float z, Direction
 
   for (size_t i = 0; i < len; ++i) {
     char &c = str.at(i);
-    glPushMatrix();
-    glTranslatef(X, y, z);
-    DrawChar(c);
-    glPopMatrix();
+    AppendChar(lines, {X, y, z}, c);
     if (c == '.') {
       X += dot;
     } else {
@@ -31,156 +28,153 @@ void NumberGraphic::DrawNumber(string str, float x, float y, float z, Direction
   }
 }
 
-void NumberGraphic::DrawAxis(char c, float x, float y, float z) {
-  glPushMatrix();
-  glTranslatef(x, y, z);
-  DrawChar(c);
-  glPopMatrix();
+void NumberGraphic::AppendAxis(LineBatch &lines, char c, float x, float y, float z) {
+  AppendChar(lines, {x, y, z}, c);
 }
 
-void NumberGraphic::DrawChar(char &c) {
+void NumberGraphic::AppendChar(LineBatch &lines, Vec3 at, char &c) {
   switch (c) {
     case '-':
-      Minus();
+      Minus(lines, at);
       break;
     case '.':
-      Dot();
+      Dot(lines, at);
       break;
     case '0':
-      Zero();
+      Zero(lines, at);
       break;
     case '1':
-      One();
+      One(lines, at);
       break;
     case '2':
-      Two();
+      Two(lines, at);
       break;
     case '3':
-      Three();
+      Three(lines, at);
       break;
     case '4':
-      Four();
+      Four(lines, at);
       break;
     case '5':
-      Five();
+      Five(lines, at);
       break;
     case '6':
-      Six();
+      Six(lines, at);
       break;
     case '7':
-      Seven();
+      Seven(lines, at);
       break;
     case '8':
-      Eight();
+      Eight(lines, at);
       break;
     case '9':
-      Nine();
+      Nine(lines, at);
       break;
     case 'x':
-      XAxis();
+      XAxis(lines, at);
       break;
     case 'y':
-      YAxis();
+      YAxis(lines, at);
       break;
     case 'z':
-      ZAxis();
+      ZAxis(lines, at);
       break;
   }
 }
 
-void NumberGraphic::Minus() {
-  Line({0, 0.5, 0}, {1, 0.5, 0});
+void NumberGraphic::Minus(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {0, 0.5, 0}, {1, 0.5, 0});
 }
 
-void NumberGraphic::Dot() {
-  Line({0.1, 0, 0}, {0.1, 0.2, 0});
+void NumberGraphic::Dot(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {0.1, 0, 0}, {0.1, 0.2, 0});
 }
 
-void NumberGraphic::Zero() {
-  Line({0, 0, 0}, {0, 1, 0});
-  Line({0, 1, 0}, {1, 1, 0});
-  Line({1, 1, 0}, {1, 0, 0});
-  Line({1, 0, 0}, {0, 0, 0});
+void NumberGraphic::Zero(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {0, 0, 0}, {0, 1, 0});
+  Line(lines, at, {0, 1, 0}, {1, 1, 0});
+  Line(lines, at, {1, 1, 0}, {1, 0, 0});
+  Line(lines, at, {1, 0, 0}, {0, 0, 0});
 }
 
-void NumberGraphic::One() {
-  Line({0.5, 0, 0}, {0.5, 1, 0});
+void NumberGraphic::One(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {0.5, 0, 0}, {0.5, 1, 0});
 }
 
-void NumberGraphic::Two() {
-  Line({0, 1, 0}, {1, 1, 0});
-  Line({1, 1, 0}, {1, 0.5, 0});
-  Line({1, 0.5, 0}, {0, 0.5, 0});
-  Line({0, 0.5, 0}, {0, 0, 0});
-  Line({0, 0, 0}, {1, 0, 0});
+void NumberGraphic::Two(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {0, 1, 0}, {1, 1, 0});
+  Line(lines, at, {1, 1, 0}, {1, 0.5, 0});
+  Line(lines, at, {1, 0.5, 0}, {0, 0.5, 0});
+  Line(lines, at, {0, 0.5, 0}, {0, 0, 0});
+  Line(lines, at, {0, 0, 0}, {1, 0, 0});
 }
 
-void NumberGraphic::Three() {
-  Line({1, 0, 0}, {1, 1, 0});
-  Line({1, 1, 0}, {0, 1, 0});
-  Line({1, 0.5, 0}, {0, 0.5, 0});
-  Line({1, 0, 0}, {0, 0, 0});
+void NumberGraphic::Three(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {1, 0, 0}, {1, 1, 0});
+  Line(lines, at, {1, 1, 0}, {0, 1, 0});
+  Line(lines, at, {1, 0.5, 0}, {0, 0.5, 0});
+  Line(lines, at, {1, 0, 0}, {0, 0, 0});
 }
 
-void NumberGraphic::Four() {
-  Line({0, 1, 0}, {0, 0.5, 0});
-  Line({0, 0.5, 0}, {1, 0.5, 0});
-  Line({1, 1, 0}, {1, 0, 0});
+void NumberGraphic::Four(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {0, 1, 0}, {0, 0.5, 0});
+  Line(lines, at, {0, 0.5, 0}, {1, 0.5, 0});
+  Line(lines, at, {1, 1, 0}, {1, 0, 0});
 }
 
-void NumberGraphic::Five() {
-  Line({1, 1, 0}, {0, 1, 0});
-  Line({0, 1, 0}, {0, 0.5, 0});
-  Line({0, 0.5, 0}, {1, 0.5, 0});
-  Line({1, 0.5, 0}, {1, 0, 0});
-  Line({1, 0, 0}, {0, 0, 0});
+void NumberGraphic::Five(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {1, 1, 0}, {0, 1, 0});
+  Line(lines, at, {0, 1, 0}, {0, 0.5, 0});
+  Line(lines, at, {0, 0.5, 0}, {1, 0.5, 0});
+  Line(lines, at, {1, 0.5, 0}, {1, 0, 0});
+  Line(lines, at, {1, 0, 0}, {0, 0, 0});
 }
 
-void NumberGraphic::Six() {
-  Line({1, 1, 0}, {0, 1, 0});
-  Line({0, 1, 0}, {0, 0, 0});
-  Line({0, 0, 0}, {1, 0, 0});
-  Line({1, 0, 0}, {1, 0.5, 0});
-  Line({1, 0.5, 0}, {0, 0.5, 0});
+void NumberGraphic::Six(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {1, 1, 0}, {0, 1, 0});
+  Line(lines, at, {0, 1, 0}, {0, 0, 0});
+  Line(lines, at, {0, 0, 0}, {1, 0, 0});
+  Line(lines, at, {1, 0, 0}, {1, 0.5, 0});
+  Line(lines, at, {1, 0.5, 0}, {0, 0.5, 0});
 }
 
-void NumberGraphic::Seven() {
-  Line({0, 1, 0}, {1, 1, 0});
-  Line({1, 1, 0}, {1, 0, 0});
+void NumberGraphic::Seven(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {0, 1, 0}, {1, 1, 0});
+  Line(lines, at, {1, 1, 0}, {1, 0, 0});
 }
 
-void NumberGraphic::Eight() {
-  Line({0, 0, 0}, {0, 1, 0});
-  Line({0, 1, 0}, {1, 1, 0});
-  Line({1, 1, 0}, {1, 0, 0});
-  Line({1, 0, 0}, {0, 0, 0});
-  Line({0, 0.5, 0}, {1, 0.5, 0});
+void NumberGraphic::Eight(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {0, 0, 0}, {0, 1, 0});
+  Line(lines, at, {0, 1, 0}, {1, 1, 0});
+  Line(lines, at, {1, 1, 0}, {1, 0, 0});
+  Line(lines, at, {1, 0, 0}, {0, 0, 0});
+  Line(lines, at, {0, 0.5, 0}, {1, 0.5, 0});
 }
 
-void NumberGraphic::Nine() {
-  Line({1, 0.5, 0}, {0, 0.5, 0});
-  Line({0, 0.5, 0}, {0, 1, 0});
-  Line({0, 1, 0}, {1, 1, 0});
-  Line({1, 1, 0}, {1, 0, 0});
+void NumberGraphic::Nine(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {1, 0.5, 0}, {0, 0.5, 0});
+  Line(lines, at, {0, 0.5, 0}, {0, 1, 0});
+  Line(lines, at, {0, 1, 0}, {1, 1, 0});
+  Line(lines, at, {1, 1, 0}, {1, 0, 0});
 }
 
-void NumberGraphic::XAxis() {
-  Line({-0.1, 0, 0}, {1.1, 1, 0});
-  Line({-0.1, 1, 0}, {1.1, 0, 0});
+void NumberGraphic::XAxis(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {-0.1, 0, 0}, {1.1, 1, 0});
+  Line(lines, at, {-0.1, 1, 0}, {1.1, 0, 0});
 }
 
-void NumberGraphic::YAxis() {
-  Line({0, 1, 0}, {0.25, 0.25, 0});
-  Line({1, 1, 0}, {0, 0, 0});
+void NumberGraphic::YAxis(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {0, 1, 0}, {0.25, 0.25, 0});
+  Line(lines, at, {1, 1, 0}, {0, 0, 0});
 }
 
-void NumberGraphic::ZAxis() {
-  Line({0, 1, 0}, {1, 1, 0});
-  Line({1, 1, 0}, {0, 0, 0});
-  Line({0, 0, 0}, {1, 0, 0});
+void NumberGraphic::ZAxis(LineBatch &lines, Vec3 at) {
+  Line(lines, at, {0, 1, 0}, {1, 1, 0});
+  Line(lines, at, {1, 1, 0}, {0, 0, 0});
+  Line(lines, at, {0, 0, 0}, {1, 0, 0});
 }
 
-void NumberGraphic::Line(struct Vec3 start, struct Vec3 end) {
+void NumberGraphic::Line(LineBatch &lines, Vec3 at, struct Vec3 start, struct Vec3 end) {
   float x1 = start.x, y1 = start.y, x2 = end.x, y2 = end.y;
 
   // Vertical lines on the left and right edges.
@@ -204,11 +198,8 @@ void NumberGraphic::Line(struct Vec3 start, struct Vec3 end) {
     }
   }
 
-  // Draw the line from start to end.
-  glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
-  glLineWidth(thickness);
-    glBegin(GL_LINES);
-    glVertex3f(x1 * width, y1 * height, start.z);
-    glVertex3f(x2 * width, y2 * height, end.z);
-  glEnd();
+  // Add the line from start to end, relative to the character position.
+  lines.Add({at.x + x1 * width, at.y + y1 * height, at.z + start.z},
+            {at.x + x2 * width, at.y + y2 * height, at.z + end.z},
+            {0.0f, 0.0f, 0.0f, 1.0f}, thickness);
 }
\ No newline at end of file
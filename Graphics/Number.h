@@ -1,13 +1,5 @@
 #pragma once
-#ifdef __APPLE__
-/* Defined before OpenGL and GLUT includes to avoid deprecation messages - this doesn't actually work */
-#define GL_SILENCE_DEPRECATION
-#include <OpenGL/gl.h>
-#include <GLUT/glut.h>
-#else
-#include <GL/gl.h>
-#include <GL/glut.h>
-#endif
+#include "Graphics/Lines.h"
 #include "Utils/MathUtils.h"
 #include <string>
 
@@ -25,23 +17,24 @@ namespace NumberGraphic {
   const float height = 0.08f;
   const float thickness = 5.0f;
 
-  void DrawNumber(string str, float x, float y, float z, Direction dir);
-  void DrawAxis(char c, float x, float y, float z);
-  void DrawChar(char &c);
-  void Minus();
-  void Dot();
-  void Zero();
-  void One();
-  void Two();
-  void Three();
-  void Four();
-  void Five();
-  void Six();
-  void Seven();
-  void Eight();
-  void Nine();
-  void XAxis();
-  void YAxis();
-  void ZAxis();
-  void Line(struct Vec3 start, struct Vec3 end);
+  // Number labels and axis names are added to a batch as line strokes.
+  void AppendNumber(LineBatch &lines, string str, float x, float y, float z, Direction dir);
+  void AppendAxis(LineBatch &lines, char c, float x, float y, float z);
+  void AppendChar(LineBatch &lines, Vec3 at, char &c);
+  void Minus(LineBatch &lines, Vec3 at);
+  void Dot(LineBatch &lines, Vec3 at);
+  void Zero(LineBatch &lines, Vec3 at);
+  void One(LineBatch &lines, Vec3 at);
+  void Two(LineBatch &lines, Vec3 at);
+  void Three(LineBatch &lines, Vec3 at);
+  void Four(LineBatch &lines, Vec3 at);
+  void Five(LineBatch &lines, Vec3 at);
+  void Six(LineBatch &lines, Vec3 at);
+  void Seven(LineBatch &lines, Vec3 at);
+  void Eight(LineBatch &lines, Vec3 at);
+  void Nine(LineBatch &lines, Vec3 at);
+  void XAxis(LineBatch &lines, Vec3 at);
+  void YAxis(LineBatch &lines, Vec3 at);
+  void ZAxis(LineBatch &lines, Vec3 at);
+  void Line(LineBatch &lines, Vec3 at, struct Vec3 start, struct Vec3 end);
 };
\ No newline at end of file
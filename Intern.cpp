@@ -0,0 +1,63 @@
+#include "Intern.h"
+#include <string.h>
+#include <unordered_set>
+#include <functional>
+
+using namespace Expression;
+
+size_t Interner::KeyHash::operator()(const Key &key) const {
+  size_t h = hash<int>()(key.Kind);
+  h = h * 31 + hash<Expr *>()(key.First);
+  h = h * 31 + hash<Expr *>()(key.Second);
+  h = h * 31 + hash<uint32_t>()(key.ValueBits);
+  h = h * 31 + hash<int>()(key.Precision);
+  return h;
+}
+
+Expr *Interner::Intern(Expr *E) {
+  auto Visited = canonical.find(E);
+  if (Visited != canonical.end()) {
+    return Visited->second;
+  }
+
+  Expr **first, **second;
+  size_t numChildren = ChildSlots(E, first, second);
+  if (numChildren > 0) *first = Intern(*first);
+  if (numChildren > 1) *second = Intern(*second);
+
+  Key key = {E->Kind, first ? *first : nullptr, second ? *second : nullptr, 0, 0};
+  if (E->Kind == ExprKind::ValKind) {
+    // Compare constants bit for bit so that e.g. 0 and -0 stay distinct.
+    Val *V = static_cast<Val *>(E);
+    memcpy(&key.ValueBits, &V->V, sizeof(float));
+    key.Precision = V->P;
+  }
+
+  Expr *Result = table.emplace(key, E).first->second;
+  canonical[E] = Result;
+  return Result;
+}
+
+void Interner::Intern(vector<Expr *> &roots) {
+  for (Expr *&Root : roots) {
+    Root = Intern(Root);
+  }
+}
+
+static void CountNodes(Expr *E, unordered_set<Expr *> &seen) {
+  if (!seen.insert(E).second) {
+    return;
+  }
+  Expr **first, **second;
+  size_t numChildren = ChildSlots(E, first, second);
+  if (numChildren > 0) CountNodes(*first, seen);
+  if (numChildren > 1) CountNodes(*second, seen);
+}
+
+size_t Expression::CountNodes(const vector<Expr *> &roots) {
+  unordered_set<Expr *> seen;
+  for (Expr *Root : roots) {
+    ::CountNodes(Root, seen);
+  }
+  return seen.size();
+}
@@ -0,0 +1,54 @@
+#ifndef VECTORFIELD_INTERN
+#define VECTORFIELD_INTERN
+#include "Expr.h"
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+namespace Expression {
+  // Hash-consing table for Expr nodes. Intern rewrites a tree in place so
+  // that structurally identical subexpressions (same kind, same value and
+  // the same interned children) are represented by a single node, turning
+  // the tree into a DAG. Later Interns through the same table also share
+  // nodes with everything interned before.
+  //
+  // Only child pointers are rewritten; the nodes that are dropped in favor
+  // of an identical one are left alone, so anything still pointing at them
+  // keeps working.
+  class Interner {
+  public:
+    Expr *Intern(Expr *E);
+    void Intern(vector<Expr *> &roots);
+
+    // Number of distinct nodes in the table.
+    size_t Size() const { return table.size(); }
+
+  private:
+    struct Key {
+      ExprKind Kind;
+      Expr *First;
+      Expr *Second;
+      uint32_t ValueBits;
+      int Precision;
+      bool operator==(const Key &other) const {
+        return Kind == other.Kind && First == other.First && Second == other.Second &&
+               ValueBits == other.ValueBits && Precision == other.Precision;
+      }
+    };
+    struct KeyHash {
+      size_t operator()(const Key &key) const;
+    };
+
+    unordered_map<Key, Expr *, KeyHash> table;
+    // Every node already visited, mapped to its representative, so that
+    // shared subtrees of the input are only walked once.
+    unordered_map<Expr *, Expr *> canonical;
+  };
+
+  // Number of distinct nodes reachable from roots, counting shared nodes once.
+  extern size_t CountNodes(const vector<Expr *> &roots);
+}
+
+#endif
@@ -0,0 +1,228 @@
+#include "Jobs.h"
+#include "Parsing/PrecedenceParser.h"
+#include "Utils/StringUtils.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+using namespace StringUtils;
+
+// Part of a curve between two samples, with the sample at its middle.
+struct CurveInterval {
+  float T0, T1;
+  Vec3 P0, P1;
+  float TMid;
+  Vec3 PMid;
+  int Depth;
+  // Above 1 if the interval is to be split.
+  float Error;
+
+  bool operator<(const CurveInterval &other) const {
+    return Error < other.Error;
+  }
+};
+
+struct CurveSample {
+  float T;
+  Vec3 P;
+  bool Arrow;
+};
+
+bool SampleFunction(Expr *x, Expr *y, Expr *z, float tMin, float tMax, int numVectors, FunctionSamples &samples, const atomic<bool> *cancel, const FunctionSampling &sampling) {
+  numVectors = max(numVectors, 1);
+  samples.TStep = MathUtils::Abs(tMax - tMin) / (2 * numVectors);
+  samples.Points.clear();
+  samples.ArrowIndices.clear();
+  samples.MinCoordinate = numeric_limits<float>::max();
+  samples.MaxCoordinate = numeric_limits<float>::min();
+  samples.MinArrowLength = numeric_limits<float>::max();
+  samples.MaxArrowLength = numeric_limits<float>::min();
+
+  // Checking for cancellation every point would cost more than the point.
+  const size_t cancelInterval = 1024;
+  size_t numEvals = 0;
+  bool cancelled = false;
+  auto eval = [&](float t) {
+    if (cancel && ++numEvals % cancelInterval == 0 && cancel->load(memory_order_relaxed)) {
+      cancelled = true;
+    }
+    return Vec3{x->Eval(t, 0, 0), y->Eval(t, 0, 0), z->Eval(t, 0, 0)};
+  };
+
+  // The coarsest sampling is an even grid of at least minIntervals
+  // intervals, with the arrow points among its points.
+  const int minIntervals = 16;
+  int perArrow = (minIntervals + numVectors - 1) / numVectors;
+  int numIntervals = numVectors * perArrow;
+  vector<CurveSample> curve;
+  curve.reserve(numIntervals + 1);
+  for (int i = 0; i <= numIntervals; ++i) {
+    float t = i == numIntervals ? tMax : tMin + (tMax - tMin) * i / numIntervals;
+    curve.push_back({t, eval(t), i % perArrow == 0});
+  }
+  if (cancelled) return false;
+
+  // The chord tolerance is relative to the size of the coarse curve.
+  Vec3 low = curve[0].P;
+  Vec3 high = curve[0].P;
+  for (const CurveSample &sample : curve) {
+    low = {min(low.x, sample.P.x), min(low.y, sample.P.y), min(low.z, sample.P.z)};
+    high = {max(high.x, sample.P.x), max(high.y, sample.P.y), max(high.z, sample.P.z)};
+  }
+  float size = Vector::Length(low, high);
+  if (!(size > 0)) {
+    size = 1;
+  }
+  float maxDeviation = sampling.Tolerance * size;
+
+  auto makeInterval = [&](float t0, Vec3 p0, float t1, Vec3 p1, int depth) {
+    CurveInterval interval = {t0, t1, p0, p1, 0.5f * (t0 + t1), {}, depth, 0};
+    interval.PMid = eval(interval.TMid);
+    Vec3 chordMid = {0.5f * (p0.x + p1.x), 0.5f * (p0.y + p1.y), 0.5f * (p0.z + p1.z)};
+    float deviation = Vector::Length(chordMid, interval.PMid);
+    float turn = Vector::Angle(Vector::GetVector(p0, interval.PMid), Vector::GetVector(interval.PMid, p1));
+    interval.Error = max(deviation / maxDeviation, turn / sampling.MaxTurn);
+    // Points that do not evaluate to numbers are not refined.
+    if (!(interval.Error >= 0)) {
+      interval.Error = 0;
+    }
+    return interval;
+  };
+
+  // Splitting the worst interval first spends a limited budget where the
+  // curve needs it most.
+  priority_queue<CurveInterval> intervals;
+  for (int i = 0; i < numIntervals; ++i) {
+    intervals.push(makeInterval(curve[i].T, curve[i].P, curve[i + 1].T, curve[i + 1].P, 0));
+  }
+  size_t maxSamples = max(sampling.MaxSamples, curve.size());
+  while (!intervals.empty() && curve.size() < maxSamples && intervals.top().Error > 1) {
+    if (cancelled) return false;
+    CurveInterval interval = intervals.top();
+    intervals.pop();
+    curve.push_back({interval.TMid, interval.PMid, false});
+    if (interval.Depth < sampling.MaxDepth) {
+      intervals.push(makeInterval(interval.T0, interval.P0, interval.TMid, interval.PMid, interval.Depth + 1));
+      intervals.push(makeInterval(interval.TMid, interval.PMid, interval.T1, interval.P1, interval.Depth + 1));
+    }
+  }
+  if (cancelled) return false;
+
+  bool increasing = tMax >= tMin;
+  sort(curve.begin(), curve.end(), [increasing](const CurveSample &a, const CurveSample &b) {
+    return increasing ? a.T < b.T : a.T > b.T;
+  });
+  samples.Points.reserve(curve.size());
+  for (const CurveSample &sample : curve) {
+    Vec3 point = sample.P;
+    for (float c : {point.x, point.y, point.z}) {
+      if (c < samples.MinCoordinate) samples.MinCoordinate = c;
+      if (c > samples.MaxCoordinate) samples.MaxCoordinate = c;
+    }
+    if (sample.Arrow) {
+      float length = Vector::Length(point);
+      if (length < samples.MinArrowLength) samples.MinArrowLength = length;
+      if (length > samples.MaxArrowLength) samples.MaxArrowLength = length;
+      samples.ArrowIndices.push_back(samples.Points.size());
+    }
+    samples.Points.push_back(point);
+  }
+  return true;
+}
+
+// Bounds of the length of field over [-range, range].
+static bool LengthExtremes(VectorField *field, Vec3 range, float step, float &minLength, float &maxLength, const atomic<bool> &cancel) {
+  LengthBounds bounds;
+  if (!field->BoundLengths(range.x, range.y, range.z, bounds, LengthSearch(), &cancel)) {
+    return false;
+  }
+  if (bounds.Converged) {
+    minLength = bounds.Min;
+    maxLength = bounds.Max;
+    return true;
+  }
+  // Intervals too wide to narrow down (e.g. a varying exponent); the grid
+  // at least gives lengths that are actually drawn.
+  return field->MinMaxLengths(range.x, range.y, range.z, step, minLength, maxLength, 0, &cancel);
+}
+
+bool FieldJob::Run(const atomic<bool> &cancel) {
+  // Every node parsed here, and every node later derived from them, lives in
+  // this arena, which is freed along with the last field that uses it.
+  shared_ptr<ExprArena> arena = make_shared<ExprArena>();
+  ExprArena::Scope scope(arena.get());
+  PrecedenceParser parser(LexMode::MultiVariable, Debug ? &Log : nullptr);
+
+  Expr *i, *j, *k;
+  {
+    ProfileScope profile("FieldJob parse");
+    i = parser.Parse(IText);
+    if (!i) {
+      Errors += "Failed to parse function for " + Italic("i") + ".<br/>";
+    }
+    j = parser.Parse(JText);
+    if (!j) {
+      Errors += "Failed to parse function for " + Italic("j") + ".<br/>";
+    }
+    k = parser.Parse(KText);
+    if (!k) {
+      Errors += "Failed to parse function for " + Italic("k") + ".<br/>";
+    }
+  }
+  if (!Errors.empty()) {
+    return !cancel;
+  }
+
+  {
+    ProfileScope profile("FieldJob compile");
+    Field = new VectorField(i, j, k, arena);
+  }
+  if (cancel) return false;
+  {
+    ProfileScope profile("FieldJob curl");
+    // Symbolic, because LengthExtremes bounds the curl by interval
+    // evaluation of its program, which a dual curl does not have.
+    Curl = Field->Curl();
+  }
+  if (cancel) return false;
+  ProfileScope profile("FieldJob lengths");
+  return LengthExtremes(Field, Range, Step, MinFieldLength, MaxFieldLength, cancel) &&
+         LengthExtremes(Curl, Range, Step, MinCurlLength, MaxCurlLength, cancel);
+}
+
+bool StreamlineJob::Run(const atomic<bool> &cancel) {
+  // Seeds right on the edge of the range would leave it at once.
+  const float seedFraction = 0.9f;
+  Vec3 corner = {seedFraction * Range.x, seedFraction * Range.y, seedFraction * Range.z};
+  vector<Vec3> seeds = Seeds::Grid({-corner.x, -corner.y, -corner.z}, corner, SeedsX, SeedsY, SeedsZ);
+  return TraceStreamlines(*Field, seeds, Options, Lines, 0, &cancel);
+}
+
+bool FunctionJob::Run(const atomic<bool> &cancel) {
+  Arena = make_shared<ExprArena>();
+  ExprArena::Scope scope(Arena.get());
+  PrecedenceParser parser(LexMode::SingleVariable, Debug ? &Log : nullptr);
+
+  X = parser.Parse(XText);
+  if (!X) {
+    Errors += "Failed to parse function for " + Italic("x") + ".<br/>";
+  }
+  Y = parser.Parse(YText);
+  if (!Y) {
+    Errors += "Failed to parse function for " + Italic("y") + ".<br/>";
+  }
+  Z = parser.Parse(ZText);
+  if (!Z) {
+    Errors += "Failed to parse function for " + Italic("z") + ".<br/>";
+  }
+  if (!Errors.empty()) {
+    return !cancel;
+  }
+  if (TMax - TMin < 0.005) {
+    RangeError = true;
+    return !cancel;
+  }
+  ProfileScope profile("FunctionJob sample");
+  return SampleFunction(X, Y, Z, TMin, TMax, NumVectors, Samples, &cancel, Sampling);
+}
@@ -0,0 +1,154 @@
+#ifndef VECTORFIELD_JOBS
+#define VECTORFIELD_JOBS
+#include "Expr.h"
+#include "ExprArena.h"
+#include "VectorField.h"
+#include "Streamlines.h"
+#include "Utils/Log.h"
+#include "Utils/MathUtils.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Expression;
+using namespace std;
+
+// Hands out cancellation flags for one kind of job, where starting a new job
+// cancels the previous one (e.g. a field that is still being sampled when
+// the user submits another). Meant to be used from a single thread.
+class JobSlot {
+public:
+  // Cancels the current job, if any, and returns the flag of a new one.
+  shared_ptr<atomic<bool>> Start() {
+    Cancel();
+    current = make_shared<atomic<bool>>(false);
+    return current;
+  }
+
+  void Cancel() {
+    if (current) *current = true;
+  }
+
+private:
+  shared_ptr<atomic<bool>> current;
+};
+
+// Points of a vector-valued function of t from tMin to tMax. The curve is
+// sampled adaptively: more densely where it bends, less where it is
+// straight. The arrows are at evenly spaced t, every 2 * TStep.
+struct FunctionSamples {
+  float TStep = 0;
+  // Points of the curve from tMin to tMax.
+  vector<Vec3> Points;
+  // Indices in Points of the arrows, in order.
+  vector<int> ArrowIndices;
+  // Extremes over the x, y and z coordinates of all points.
+  float MinCoordinate;
+  float MaxCoordinate;
+  // Extremes of the lengths of the arrows.
+  float MinArrowLength;
+  float MaxArrowLength;
+};
+
+// Limits of the adaptive sampling. An interval of the curve is split at its
+// middle while either
+//   - the curve at the middle is further than Tolerance (as a fraction of
+//     the size of the curve) from the chord, or
+//   - the curve turns by more than MaxTurn radians across the interval,
+// worst intervals first, until MaxSamples points have been taken or the
+// intervals are MaxDepth halvings smaller than the arrow spacing.
+struct FunctionSampling {
+  float Tolerance = 0.001f;
+  float MaxTurn = 0.1f;
+  size_t MaxSamples = 16384;
+  int MaxDepth = 16;
+};
+
+// Returns false if cancel was set before every point was taken.
+extern bool SampleFunction(Expr *x, Expr *y, Expr *z, float tMin, float tMax, int numVectors, FunctionSamples &samples, const atomic<bool> *cancel = nullptr, const FunctionSampling &sampling = FunctionSampling());
+
+// Parses the components of a vector field and builds its curl and length
+// extremes, everything needed before the field can be drawn. Runs on any
+// thread: the nodes are allocated in an arena of the job's own.
+struct FieldJob {
+  string IText;
+  string JText;
+  string KText;
+  // Box the length extremes are bounded over, and the grid sampled instead
+  // where bounding fails.
+  Vec3 Range;
+  float Step;
+
+  // Set if a component could not be parsed; nothing else is built then.
+  string Errors;
+  // Parser messages, if Debug is set.
+  bool Debug = false;
+  BufferSink Log;
+
+  // Owned by the job until they are taken (and set to null).
+  VectorField *Field = nullptr;
+  VectorField *Curl = nullptr;
+  float MinFieldLength;
+  float MaxFieldLength;
+  float MinCurlLength;
+  float MaxCurlLength;
+
+  ~FieldJob() {
+    delete Field;
+    delete Curl;
+  }
+
+  // Returns false if the job was cancelled before it was done.
+  bool Run(const atomic<bool> &cancel);
+};
+
+// Traces streamlines of a field from a grid of seeds over its range.
+struct StreamlineJob {
+  // A copy owned by the job, so that the field shown can be replaced while
+  // the job runs.
+  VectorField *Field = nullptr;
+  Vec3 Range;
+  // Seeds per axis, spread over most of the range.
+  int SeedsX = 8;
+  int SeedsY = 8;
+  int SeedsZ = 3;
+  StreamlineOptions Options;
+
+  Streamlines Lines;
+
+  ~StreamlineJob() {
+    delete Field;
+  }
+
+  bool Run(const atomic<bool> &cancel);
+};
+
+// Parses the components of a vector-valued function and samples it.
+struct FunctionJob {
+  string XText;
+  string YText;
+  string ZText;
+  float TMin;
+  float TMax;
+  int NumVectors;
+
+  // Set if a component could not be parsed. RangeError is set instead if
+  // the t range is empty. Nothing is sampled in either case.
+  string Errors;
+  bool RangeError = false;
+  bool Debug = false;
+  BufferSink Log;
+
+  // Owns the nodes of X, Y and Z.
+  shared_ptr<ExprArena> Arena;
+  Expr *X = nullptr;
+  Expr *Y = nullptr;
+  Expr *Z = nullptr;
+  FunctionSampling Sampling;
+  FunctionSamples Samples;
+
+  bool Run(const atomic<bool> &cancel);
+};
+
+#endif
@@ -1,117 +1,108 @@
 #include "Parsing/Lexer.h"
 #include "Expr.h"
+#include <stdlib.h>
 
 void Lexer::Print(string str) {
   if (debug)
-    debug->append(QString(str.c_str()));
+    debug->Append(str);
 }
 
 void Lexer::Debug(string str) {
-  if (true) Print(str);
+  if (trace) Print(str);
 }
 
-vector<Lexeme> Lexer::Lex(string str) {
+// Lexemes that may be directly followed by an implicit *.
+static bool IsFactor(Lex kind) {
+  switch (kind) {
+    case Lex::TVar:
+    case Lex::XVar:
+    case Lex::YVar:
+    case Lex::ZVar:
+    case Lex::Number:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Lexemes that may be directly preceded by an implicit *.
+static bool IsImplicitFactor(Lex kind) {
+  switch (kind) {
+    case Lex::TVar:
+    case Lex::XVar:
+    case Lex::YVar:
+    case Lex::ZVar:
+    case Lex::SinFunc:
+    case Lex::CosFunc:
+      return true;
+    default:
+      return false;
+  }
+}
+
+vector<Lexeme> Lexer::Lex(string_view str) {
   vector<Lexeme> Result;
+  Result.reserve(str.length());
+  failed = false;
 
+  size_t inserted = 0;
   size_t i = 0;
   while (i < str.length()) {
     Lexeme L = GetLexeme(str, i);
     if (L.Kind == Lex::Error) {
       Print("~~~~~~ ERROR: encountered error in lexer");
+      failed = true;
       return Result;
     }
-    if (L.Kind != Lex::Space) {
-      Result.push_back(L);
+    if (L.Kind == Lex::Space) {
+      continue;
     }
-  }
-
-  auto IsNotOp = [](Lexeme L) {
-    switch (L.Kind) {
-      case Lex::TVar:
-      case Lex::XVar:
-      case Lex::YVar:
-      case Lex::ZVar:
-      case Lex::Number:
-        return true;
-      default:
-        return false;
-    }
-    return false;
-  };
-
-  auto IsFirst = [](Lexeme L) {
-    switch (L.Kind) {
-      case Lex::TVar:
-      case Lex::XVar:
-      case Lex::YVar:
-      case Lex::ZVar:
-      case Lex::Number:
-        return true;
-      default:
-        return false;
-    }
-    return false;
-  };
-
-  auto IsSecond = [](Lexeme L) {
-    switch (L.Kind) {
-      case Lex::TVar:
-      case Lex::XVar:
-      case Lex::YVar:
-      case Lex::ZVar:
-      case Lex::SinFunc:
-      case Lex::CosFunc:
-        return true;
-      default:
-        return false;
-    }
-    return false;
-  };
-
-  for (size_t idx = 0; idx < Result.size() - 1; ++idx) {
-    Lexeme Curr = Result.at(idx);
-    Lexeme Next = Result.at(idx + 1);
-    if (IsFirst(Curr) && IsSecond(Next)) {
-      size_t Loc = Next.Loc;
-      Print("Inserting * at index " + to_string(idx + 1) + " and loc " + to_string(Loc));
-      Lexeme Mult = {Lex::Times, Loc};
-      Result.insert(Result.begin() + idx + 1, Mult);
-      for (size_t j = idx + 2; j < Result.size(); ++j) {
-        Result.at(j).Loc++;
-      }
+    if (!Result.empty() && IsFactor(Result.back().Kind) && IsImplicitFactor(L.Kind)) {
+      Lexeme Mult = {Lex::Times, L.Loc + inserted};
+      if (trace) Debug("Inserting * at index " + to_string(Result.size()) + " and loc " + to_string(Mult.Loc));
+      Result.push_back(Mult);
+      ++inserted;
     }
+    L.Loc += inserted;
+    Result.push_back(L);
   }
 
   return Result;
 }
 
-Lexeme Lexer::GetLexeme(string str, size_t &index) {
-  char &c = str.at(index);
-  Debug("Current character is: \"" + string(1, c) + "\"");
+Lexeme Lexer::GetLexeme(string_view str, size_t &index) {
+  char c = str[index];
+  if (trace) Debug("Current character is: \"" + string(1, c) + "\"");
   if (IsDigit(c)) {
-    Debug("Current character is a digit");
     if (c == '.') {
       Print("~~~~~~ ERROR: dot found but not in a numerical value");
       return {Lex::Error};
     }
 
-    string NumberStr = "";
     int Precision = 0;
     bool foundDot = false;
-    char &next = c;
     size_t loc = index;
-    while (IsDigit(next) && index < str.length()) {
-      NumberStr += string(1, next);
-      if (next == '.')
+    while (index < str.length() && IsDigit(str[index])) {
+      if (str[index] == '.')
         foundDot = true;
-      if (next != '.' && foundDot)
+      else if (foundDot)
         ++Precision;
       ++index;
-      if (index < str.length())
-        next = str.at(index);
     }
-    float Val = stof(NumberStr);
-    Debug("NumberStr: " + NumberStr);
+
+    // Like stof, strtof stops at a second dot. Numbers too long for the
+    // buffer are rare enough to take the allocating path.
+    string_view NumberStr = str.substr(loc, index - loc);
+    char buffer[64];
+    float Val;
+    if (NumberStr.length() < sizeof(buffer)) {
+      NumberStr.copy(buffer, NumberStr.length());
+      buffer[NumberStr.length()] = '\0';
+      Val = strtof(buffer, nullptr);
+    } else {
+      Val = strtof(string(NumberStr).c_str(), nullptr);
+    }
+    if (trace) Debug("NumberStr: " + string(NumberStr));
     return {Lex::Number, loc, Val, Precision};
   }
 
@@ -157,7 +148,7 @@ Lexeme Lexer::GetLexeme(string str, size_t &index) {
     }
     case '-': {
       if (index < str.length() - 1) {
-        if (str.at(index + 1) == ' ') {
+        if (str[index + 1] == ' ') {
           Lexeme L = {Lex::Minus, index};
           ++index;
           return L;
@@ -198,7 +189,7 @@ Lexeme Lexer::GetLexeme(string str, size_t &index) {
         return {Lex::Error};
       }
       if (index < str.length() - 2) {
-        if (str.at(index + 1) == 'i' && str.at(index + 2) == 'n') {
+        if (str[index + 1] == 'i' && str[index + 2] == 'n') {
           Lexeme L = {Lex::SinFunc, index};
           index += 3;
           return L;
@@ -213,7 +204,7 @@ Lexeme Lexer::GetLexeme(string str, size_t &index) {
         return {Lex::Error};
       }
       if (index < str.length() - 2) {
-        if (str.at(index + 1) == 'o' && str.at(index + 2) == 's') {
+        if (str[index + 1] == 'o' && str[index + 2] == 's') {
           Lexeme L = {Lex::CosFunc, index};
           index += 3;
           return L;
@@ -236,7 +227,7 @@ Lexeme Lexer::GetLexeme(string str, size_t &index) {
   return {Lex::Error};
 }
 
-bool Lexer::IsDigit(char &c) {
+bool Lexer::IsDigit(char c) {
   switch (c) {
     case '1':
     case '2':
@@ -258,8 +249,8 @@ bool Lexer::IsDigit(char &c) {
   return false;
 }
 
-string Lexer::ToString(string str, vector<Lexeme> lexemes) {
-  string message = "$$$ Lexemes for " + str + ": $$$\n{ ";
+string Lexer::ToString(string_view str, const vector<Lexeme> &lexemes) {
+  string message = "$$$ Lexemes for " + string(str) + ": $$$\n{ ";
   size_t msgIndex = 0;
   for (auto I = lexemes.begin(); I != lexemes.end(); ++I) {
     ++msgIndex;
@@ -1,7 +1,8 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
-#include <QTextBrowser>
+#include "Utils/Log.h"
 
 using namespace std;
 
@@ -40,17 +41,27 @@ struct Lexeme {
 
 class Lexer {
 public:
-  Lexer(LexMode mode, QTextBrowser *browser) : mode(mode), debug(browser) {}
-  vector<Lexeme> Lex(string str);
-  static string ToString(string str, vector<Lexeme> lexemes);
+  // With trace set, every character and every implicit multiplication is
+  // reported to the browser; otherwise only errors are.
+  Lexer(LexMode mode, LogSink *sink, bool trace = false) : mode(mode), debug(sink), trace(trace) {}
+  // Lexes str in a single pass, inserting a * between a number or variable
+  // and a directly following variable or trig function (e.g. 2x, x sin(y)).
+  // The Loc of each lexeme is its index in str plus the number of *s
+  // inserted before it. On error, returns the lexemes up to the error and
+  // Failed() is true.
+  vector<Lexeme> Lex(string_view str);
+  bool Failed() const { return failed; }
+  static string ToString(string_view str, const vector<Lexeme> &lexemes);
   static string LexemeString(Lexeme L);
   static string LexemeStr(Lexeme L);
 
 private:
   LexMode mode;
-  QTextBrowser *debug = nullptr;
+  LogSink *debug = nullptr;
+  bool trace = false;
+  bool failed = false;
   void Print(string message);
   void Debug(string message);
-  Lexeme GetLexeme(string str, size_t &index);
-  bool IsDigit(char &c);
+  Lexeme GetLexeme(string_view str, size_t &index);
+  static bool IsDigit(char c);
 };
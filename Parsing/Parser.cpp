@@ -2,7 +2,8 @@
 #include <iostream>
 
 void Parser::Print(string str) {
-  debug->append(QString(str.c_str()));
+  if (!debug) return;
+  debug->Append(str);
 }
 
 void Parser::Debug(string str) {
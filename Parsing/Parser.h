@@ -4,7 +4,8 @@
 #include <map>
 #include <vector>
 #include <set>
-#include <QTextBrowser>
+#include "Utils/Log.h"
+#include <algorithm>
 
 using namespace Expression;
 using namespace std;
@@ -24,7 +25,7 @@ enum Error {
 };
 
 public:
-  Parser(QTextBrowser *browser) : debug(browser), error(Error::None) {
+  Parser(LogSink *sink) : debug(sink), error(Error::None) {
     error = Error::None;
     badIndex = -1;
     nullChildOpIndex = -1;
@@ -34,7 +35,7 @@ public:
   bool HasError();
 
 private:
-  QTextBrowser *debug;
+  LogSink *debug;
   Error error;
   size_t badIndex;
   size_t nullChildOpIndex;
@@ -2,7 +2,7 @@
 
 void ParserAlt::Print(string str) {
   if (!debug) return;
-  debug->append(QString(str.c_str()));
+  debug->Append(str);
 }
 
 void ParserAlt::Debug(string str) {
@@ -20,8 +20,8 @@ Expr *ParserAlt::Parse(string str) {
     return nullptr;
   }
 
-  Lexer *lexer = new Lexer(mode, debug);
-  lexemes = lexer->Lex(str);
+  Lexer lexer(mode, debug);
+  lexemes = lexer.Lex(str);
 
   Print(Lexer::ToString(str, lexemes));
 
@@ -5,7 +5,8 @@
 #include <map>
 #include <vector>
 #include <set>
-#include <QTextBrowser>
+#include "Utils/Log.h"
+#include <algorithm>
 
 using namespace Expression;
 using namespace std;
@@ -25,12 +26,12 @@ enum Error {
 };
 
 public:
-  ParserAlt(LexMode mode, QTextBrowser *browser = nullptr) : mode(mode), debug(browser) {}
+  ParserAlt(LexMode mode, LogSink *sink = nullptr) : mode(mode), debug(sink) {}
   Expr *Parse(string str);
 
 private:
   LexMode mode;
-  QTextBrowser *debug;
+  LogSink *debug;
   vector<Lexeme> lexemes;
 
   void Print(string s);
@@ -0,0 +1,196 @@
+#include "Parsing/PrecedenceParser.h"
+
+void PrecedenceParser::Print(string str) {
+  if (!debug) return;
+  debug->Append(str);
+}
+
+void PrecedenceParser::Error(string str) {
+  Print("~~~~~~ ERROR: " + str);
+}
+
+Expr *PrecedenceParser::Parse(string str) {
+  Print("Parsing (precedence) string " + str);
+  if (str.length() < 1) {
+    Error("cannot parse an empty string");
+    return nullptr;
+  }
+
+  Lexer lexer(mode, debug);
+  lexemes = lexer.Lex(str);
+  if (lexer.Failed()) {
+    Error("could not lex " + str);
+    return nullptr;
+  }
+
+  if (debug) Print(Lexer::ToString(str, lexemes));
+
+  if (!CheckBalancedParens()) {
+    return nullptr;
+  }
+  if (lexemes.empty()) {
+    Error("there are no leaf expressions");
+    return nullptr;
+  }
+
+  operators.clear();
+  operands.clear();
+  bool expectOperand = true;
+  for (size_t index = 0; index < lexemes.size(); ++index) {
+    const Lexeme &L = lexemes[index];
+    if (expectOperand) {
+      switch (L.Kind) {
+        case Lex::TVar:
+          operands.push_back(new T());
+          break;
+        case Lex::XVar:
+          operands.push_back(new X());
+          break;
+        case Lex::YVar:
+          operands.push_back(new Y());
+          break;
+        case Lex::ZVar:
+          operands.push_back(new Z());
+          break;
+        case Lex::Number:
+          operands.push_back(new Val(L.Val, L.Precision));
+          break;
+        case Lex::SinFunc:
+        case Lex::CosFunc:
+          if (index + 1 >= lexemes.size() || lexemes[index + 1].Kind != Lex::OpenParen) {
+            Error("Trig function not immediately followed by open paren");
+            return nullptr;
+          }
+          operators.push_back(L);
+          continue;
+        case Lex::Negative:
+        case Lex::OpenParen:
+          operators.push_back(L);
+          continue;
+        default:
+          if (!operators.empty() && operators.back().Kind == Lex::Negative) {
+            Error("negation expr has a null singleton (variable or number) child");
+          } else if (IsBinary(L.Kind)) {
+            Error("left child of operator " + Lexer::LexemeString(L) + " is null");
+          } else {
+            Error("expected a variable, number or function but found " + Lexer::LexemeString(L));
+          }
+          return nullptr;
+      }
+      // A variable or number completes the operand of any pending prefix
+      // operators.
+      ReducePrefix();
+      expectOperand = false;
+    } else if (IsBinary(L.Kind)) {
+      // Operators of equal precedence are right associative, so only
+      // strictly tighter ones are reduced first.
+      Reduce(Precedence(L.Kind));
+      operators.push_back(L);
+      expectOperand = true;
+    } else if (L.Kind == Lex::CloseParen) {
+      Reduce(-1);
+      // The balanced paren check guarantees the matching open paren.
+      operators.pop_back();
+      ReducePrefix();
+    } else {
+      Error("expected an operator but found " + Lexer::LexemeString(L));
+      return nullptr;
+    }
+  }
+
+  if (expectOperand) {
+    if (!operators.empty() && IsBinary(operators.back().Kind)) {
+      Error("right child of operator " + Lexer::LexemeString(operators.back()) + " is null");
+    } else {
+      Error("expression ends without an operand");
+    }
+    return nullptr;
+  }
+
+  Reduce(-1);
+  if (operands.size() != 1 || !operators.empty()) {
+    Error("end of parsing: FinalResult is null");
+    return nullptr;
+  }
+  Expr *Result = operands.back();
+  operands.clear();
+  Print("%%% End of parsing: FinalResult is " + Result->ToString());
+  return Result;
+}
+
+bool PrecedenceParser::CheckBalancedParens() {
+  int parenLevel = 0;
+  for (size_t index = 0; index < lexemes.size(); ++index) {
+    Lexeme L = lexemes.at(index);
+    if (L.Kind == Lex::OpenParen) {
+      ++parenLevel;
+    } else if (L.Kind == Lex::CloseParen) {
+      if (parenLevel <= 0) {
+        Error("parenLevel is not positive while processing a close paren - we haven't seen enough open parens");
+        return false;
+      }
+      --parenLevel;
+    }
+  }
+  if (parenLevel != 0) {
+    Error("parenLevel " + to_string(parenLevel) + " is nonzero at the end of processing all lexemes, so parens are not balanced");
+    return false;
+  }
+  return true;
+}
+
+void PrecedenceParser::Reduce(float minPrecedence) {
+  while (!operators.empty() && IsBinary(operators.back().Kind) && Precedence(operators.back().Kind) > minPrecedence) {
+    Lexeme L = operators.back();
+    operators.pop_back();
+    Expr *right = operands.back();
+    operands.pop_back();
+    Expr *left = operands.back();
+    switch (L.Kind) {
+      case Lex::Plus: operands.back() = new Add(left, right); break;
+      case Lex::Minus: operands.back() = new Sub(left, right); break;
+      case Lex::Times: operands.back() = new Mult(left, right); break;
+      case Lex::Divide: operands.back() = new Div(left, right); break;
+      default: operands.back() = new Pow(left, right); break;
+    }
+  }
+}
+
+void PrecedenceParser::ReducePrefix() {
+  while (!operators.empty()) {
+    Lex kind = operators.back().Kind;
+    Expr *child = operands.back();
+    if (kind == Lex::Negative) {
+      operands.back() = new Neg(child);
+    } else if (kind == Lex::SinFunc) {
+      operands.back() = new Sin(child);
+    } else if (kind == Lex::CosFunc) {
+      operands.back() = new Cos(child);
+    } else {
+      return;
+    }
+    operators.pop_back();
+  }
+}
+
+bool PrecedenceParser::IsBinary(Lex kind) {
+  switch (kind) {
+    case Lex::Plus:
+    case Lex::Minus:
+    case Lex::Times:
+    case Lex::Divide:
+    case Lex::Power:
+      return true;
+    default:
+      return false;
+  }
+}
+
+float PrecedenceParser::Precedence(Lex kind) {
+  switch (kind) {
+    case Lex::Power: return 0.2f;
+    case Lex::Times:
+    case Lex::Divide: return 0.1f;
+    default: return 0.0f;
+  }
+}
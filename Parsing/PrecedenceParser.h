@@ -0,0 +1,48 @@
+#pragma once
+#include "Expr.h"
+#include "Parsing/Lexer.h"
+#include <string>
+#include <vector>
+#include "Utils/Log.h"
+
+using namespace Expression;
+using namespace std;
+
+// Single-pass operator-precedence parser over the Lexer output. Produces the
+// same trees as ParserAlt:
+//   - + and - bind loosest, then * and /, then ^, and all of them are right
+//     associative (a - b + c is a - (b + c))
+//   - negation applies to the variable, number, parenthesized group, trig
+//     function or negation immediately after it
+//   - sin and cos must be followed by a parenthesized argument
+// Operators and open parens are kept on an explicit stack, so parse time is
+// linear in the number of lexemes and the native stack depth does not grow
+// with the input, however long or deeply nested it is.
+class PrecedenceParser {
+public:
+  PrecedenceParser(LexMode mode, LogSink *sink = nullptr) : mode(mode), debug(sink) {}
+  Expr *Parse(string str);
+
+private:
+  LexMode mode;
+  LogSink *debug;
+  vector<Lexeme> lexemes;
+
+  // Pending operators and groups. Binary operators are reduced by
+  // precedence, prefix operators (negation, sin, cos) as soon as their
+  // operand is complete.
+  vector<Lexeme> operators;
+  vector<Expr *> operands;
+
+  void Print(string s);
+  void Error(string s);
+
+  bool CheckBalancedParens();
+  // Builds the pending binary operators with a precedence above
+  // minPrecedence, stopping at the innermost open paren.
+  void Reduce(float minPrecedence);
+  // Applies the pending prefix operators to the operand just completed.
+  void ReducePrefix();
+  static bool IsBinary(Lex kind);
+  static float Precedence(Lex kind);
+};
@@ -0,0 +1,95 @@
+#include "Profiler.h"
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+Profiler::Profiler() : enabled(false), ring(Capacity) {
+  for (atomic<int64_t> &counter : counters) {
+    counter = 0;
+  }
+  epoch = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler &Profiler::Shared() {
+  static Profiler profiler;
+  return profiler;
+}
+
+int64_t Profiler::Now() const {
+  return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count() - epoch;
+}
+
+// Small sequential ids, which read better in a trace than native ones.
+static uint32_t ThreadId() {
+  static atomic<uint32_t> next(1);
+  thread_local uint32_t id = next++;
+  return id;
+}
+
+void Profiler::Add(const ProfileEvent &event) {
+  lock_guard<mutex> guard(lock);
+  ring[recorded % Capacity] = event;
+  ++recorded;
+}
+
+void Profiler::Record(const char *name, int64_t start, int64_t duration) {
+  Add({name, start, duration, 0, ThreadId()});
+}
+
+int64_t Profiler::TakeCounter(ProfileCounter counter) {
+  static const char *names[] = {"draw calls", "arrows"};
+  int64_t value = counters[(int)counter].exchange(0, memory_order_relaxed);
+  if (IsEnabled()) {
+    Add({names[(int)counter], Now(), -1, value, ThreadId()});
+  }
+  return value;
+}
+
+vector<ProfileEvent> Profiler::Events() {
+  lock_guard<mutex> guard(lock);
+  vector<ProfileEvent> events;
+  size_t count = min(recorded, Capacity);
+  events.reserve(count);
+  for (size_t i = recorded - count; i < recorded; ++i) {
+    events.push_back(ring[i % Capacity]);
+  }
+  return events;
+}
+
+void Profiler::Clear() {
+  lock_guard<mutex> guard(lock);
+  recorded = 0;
+}
+
+// Names are string literals of this program, but may still need escaping.
+static string JsonString(const char *text) {
+  string result = "\"";
+  for (const char *c = text; *c; ++c) {
+    if (*c == '"' || *c == '\\') result += '\\';
+    result += *c;
+  }
+  return result + "\"";
+}
+
+bool Profiler::WriteChromeTrace(const string &path) {
+  FILE *out = fopen(path.c_str(), "w");
+  if (!out) {
+    return false;
+  }
+  fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  vector<ProfileEvent> events = Events();
+  for (size_t i = 0; i < events.size(); ++i) {
+    const ProfileEvent &e = events[i];
+    string name = JsonString(e.Name);
+    if (e.Duration >= 0) {
+      fprintf(out, "{\"name\": %s, \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, \"pid\": 1, \"tid\": %u}",
+              name.c_str(), (long long)e.Start, (long long)e.Duration, e.Thread);
+    } else {
+      fprintf(out, "{\"name\": %s, \"ph\": \"C\", \"ts\": %lld, \"pid\": 1, \"tid\": %u, \"args\": {\"value\": %lld}}",
+              name.c_str(), (long long)e.Start, e.Thread, (long long)e.Value);
+    }
+    fprintf(out, i + 1 < events.size() ? ",\n" : "\n");
+  }
+  fprintf(out, "]}\n");
+  return fclose(out) == 0;
+}
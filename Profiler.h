@@ -0,0 +1,99 @@
+#ifndef VECTORFIELD_PROFILER
+#define VECTORFIELD_PROFILER
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Things counted per frame, besides time.
+enum class ProfileCounter {
+  DrawCalls,
+  Arrows,
+  NumCounters
+};
+
+// A timed stretch of work, or the value of a counter at a point in time.
+struct ProfileEvent {
+  // A string literal.
+  const char *Name;
+  // Microseconds since the profiler started.
+  int64_t Start;
+  // Microseconds for spans, -1 for counters.
+  int64_t Duration;
+  int64_t Value;
+  uint32_t Thread;
+};
+
+// Keeps the most recent events of every thread in a ring buffer. Nothing is
+// recorded until it is enabled; until then a scope or count costs one
+// atomic load.
+class Profiler {
+public:
+  // Events kept; the oldest are overwritten first.
+  static const size_t Capacity = 1 << 15;
+
+  static Profiler &Shared();
+
+  void SetEnabled(bool on) { enabled.store(on, memory_order_relaxed); }
+  bool IsEnabled() const { return enabled.load(memory_order_relaxed); }
+
+  // Microseconds since the profiler started.
+  int64_t Now() const;
+
+  void Record(const char *name, int64_t start, int64_t duration);
+  void Count(ProfileCounter counter, int64_t amount) {
+    if (IsEnabled()) counters[(int)counter].fetch_add(amount, memory_order_relaxed);
+  }
+  // Returns what was counted since the last call and records it as a
+  // counter event, e.g. once per frame.
+  int64_t TakeCounter(ProfileCounter counter);
+
+  // The events kept, oldest first.
+  vector<ProfileEvent> Events();
+  void Clear();
+  // Chrome trace-event JSON of the events kept, for chrome://tracing or
+  // Perfetto. Returns false if path could not be written.
+  bool WriteChromeTrace(const string &path);
+
+private:
+  Profiler();
+
+  atomic<bool> enabled;
+  atomic<int64_t> counters[(int)ProfileCounter::NumCounters];
+  int64_t epoch;
+  mutex lock;
+  vector<ProfileEvent> ring;
+  // Events ever recorded; the next one goes to ring[recorded % Capacity].
+  size_t recorded = 0;
+
+  void Add(const ProfileEvent &event);
+};
+
+// Records the time from its construction to its destruction under name, a
+// string literal.
+class ProfileScope {
+public:
+  ProfileScope(const char *name) : name(name), start(Profiler::Shared().IsEnabled() ? Profiler::Shared().Now() : -1) {}
+  ~ProfileScope() {
+    if (start >= 0) {
+      Profiler::Shared().Record(name, start, Profiler::Shared().Now() - start);
+    }
+  }
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+  // Microseconds so far, or -1 if the profiler was disabled at the start.
+  int64_t Elapsed() const {
+    return start >= 0 ? Profiler::Shared().Now() - start : -1;
+  }
+
+private:
+  const char *name;
+  int64_t start;
+};
+
+#endif
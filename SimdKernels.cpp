@@ -0,0 +1,110 @@
+#include "SimdKernels.h"
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+using namespace Expression;
+
+// Every instruction set gets its own copy of the kernels. The 4-lane copy is
+// compiled for the baseline target (SSE2 on x86-64, NEON on arm64); the 8-lane
+// copy is compiled for AVX2 and only called after checking the CPU.
+#if defined(__GNUC__)
+#define SIMD_AVAILABLE 1
+
+#define SIMD_WIDTH 4
+#define SIMD_NAMESPACE Width4
+#include "SimdKernelsImpl.h"
+#undef SIMD_WIDTH
+#undef SIMD_NAMESPACE
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_AVX2_AVAILABLE 1
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#define SIMD_WIDTH 8
+#define SIMD_NAMESPACE Width8
+#include "SimdKernelsImpl.h"
+#undef SIMD_WIDTH
+#undef SIMD_NAMESPACE
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+#endif
+
+// Largest float r for which the scalar test (double)r <= 0.00001 in Div::Eval
+// holds, so the float comparison in the kernels agrees with it exactly.
+static float DivThreshold() {
+  float threshold = 0.00001f;
+  if ((double)threshold > 0.00001) {
+    threshold = nextafterf(threshold, 0.0f);
+  }
+  return threshold;
+}
+
+Simd::Isa Simd::BestIsa() {
+#if defined(SIMD_AVX2_AVAILABLE)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Isa::AVX2;
+  }
+  return Isa::SSE2;
+#elif defined(SIMD_AVAILABLE) && (defined(__aarch64__) || defined(__ARM_NEON))
+  return Isa::NEON;
+#else
+  return Isa::Scalar;
+#endif
+}
+
+static Simd::Isa &CurrentIsa() {
+  static Simd::Isa isa = Simd::BestIsa();
+  return isa;
+}
+
+Simd::Isa Simd::ActiveIsa() {
+  return CurrentIsa();
+}
+
+void Simd::SetIsa(Isa isa) {
+  Isa best = BestIsa();
+  bool supported = isa == Isa::Scalar || isa == best || (isa == Isa::SSE2 && best == Isa::AVX2);
+  CurrentIsa() = supported ? isa : best;
+}
+
+string Simd::IsaName(Isa isa) {
+  switch (isa) {
+    case Isa::Scalar: return "scalar";
+    case Isa::SSE2: return "sse2";
+    case Isa::NEON: return "neon";
+    case Isa::AVX2: return "avx2";
+  }
+  return "unknown";
+}
+
+void Simd::EvalBatch(const Program &program, const float *xs, const float *ys, const float *zs, size_t n, float *const *results) {
+  static const float divThreshold = DivThreshold();
+  switch (ActiveIsa()) {
+#if defined(SIMD_AVX2_AVAILABLE)
+    case Isa::AVX2:
+      Width8::EvalBatch(program, divThreshold, xs, ys, zs, n, results);
+      return;
+#endif
+#if defined(SIMD_AVAILABLE)
+    case Isa::SSE2:
+    case Isa::NEON:
+      Width4::EvalBatch(program, divThreshold, xs, ys, zs, n, results);
+      return;
+#endif
+    default:
+      program.EvalBatch(xs, ys, zs, n, results);
+      return;
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef VECTORFIELD_SIMDKERNELS
+#define VECTORFIELD_SIMDKERNELS
+#include "Bytecode.h"
+
+namespace Expression {
+  // Vectorized backend for Program::EvalBatch.
+  //
+  // Neg, Add, Sub, Mult and Div are evaluated lane-wise with the same IEEE
+  // operations as the scalar interpreter and are bit-identical to it.
+  // Sin, Cos, Log and Pow use polynomial approximations (after Cephes) and
+  // agree with the scalar functions within the following bounds:
+  //   sin, cos: 2 ulp for |x| <= 8192, or 1e-10 absolute close to their zeros;
+  //             larger |x| falls back to the scalar functions
+  //   log:      1 ulp for positive normal x; other x use the scalar log
+  //   pow:      |y| ulp for integer exponents |y| <= 16 (x^2 is exact),
+  //             4 + 2 * |y * ln(x)| ulp otherwise; zero, infinite and NaN
+  //             operands, and results that over- or underflow, use the
+  //             scalar pow
+  namespace Simd {
+    enum Isa {
+      Scalar = 0,
+      SSE2,
+      NEON,
+      AVX2
+    };
+
+    // Widest instruction set supported by this build and the running CPU.
+    Isa BestIsa();
+    // Instruction set currently used by EvalBatch. Defaults to BestIsa().
+    Isa ActiveIsa();
+    // Forces EvalBatch to use isa, e.g. Isa::Scalar for comparisons. Requests
+    // for an instruction set the CPU does not support use BestIsa() instead.
+    void SetIsa(Isa isa);
+    string IsaName(Isa isa);
+
+    void EvalBatch(const Program &program, const float *xs, const float *ys, const float *zs, size_t n, float *const *results);
+  }
+}
+
+#endif
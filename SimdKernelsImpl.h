@@ -0,0 +1,297 @@
+// Width-generic kernels for the SIMD backend.
+//
+// Intentionally has no include guard: SimdKernels.cpp includes this file once
+// per instruction set, with SIMD_WIDTH (lanes per vector) and SIMD_NAMESPACE
+// defined, and sometimes inside a target("...") region. It must not include
+// any headers itself so that no library code is compiled for that target.
+
+namespace SIMD_NAMESPACE {
+  const int W = SIMD_WIDTH;
+  typedef float VF __attribute__((vector_size(SIMD_WIDTH * 4)));
+  typedef int32_t VI __attribute__((vector_size(SIMD_WIDTH * 4)));
+
+  static inline VF Splat(float f) {
+    return VF{} + f;
+  }
+
+  static inline VI SplatI(int32_t i) {
+    return VI{} + i;
+  }
+
+  static inline VF Select(VI mask, VF a, VF b) {
+    return (VF)((mask & (VI)a) | (~mask & (VI)b));
+  }
+
+  static inline VF Abs(VF v) {
+    return (VF)((VI)v & SplatI(0x7fffffff));
+  }
+
+  static inline bool Any(VI mask) {
+    for (int i = 0; i < W; ++i) {
+      if (mask[i]) return true;
+    }
+    return false;
+  }
+
+  // Lanes that are not finite (inf or NaN).
+  static inline VI NonFinite(VF v) {
+    return ((VI)v & SplatI(0x7f800000)) == SplatI(0x7f800000);
+  }
+
+  static inline VF Floor(VF v) {
+    VF t = __builtin_convertvector(__builtin_convertvector(v, VI), VF);
+    return Select(t > v, t - 1.0f, t);
+  }
+
+  // Cephes sinf/cosf, sharing the range reduction between both.
+  static inline VF SinCos(VF x, bool cosine) {
+    VF ax = Abs(x);
+    VI j = __builtin_convertvector(ax * 1.27323954473516f, VI);
+    j = (j + 1) & ~1;
+    VF y = __builtin_convertvector(j, VF);
+    VI sign;
+    if (cosine) {
+      // cos(x) = sin(|x| + pi/2), i.e. two octants further along.
+      j = (j + 2) & 7;
+      sign = (j & 4) != 0;
+    } else {
+      j = j & 7;
+      sign = ((j & 4) != 0) ^ (x < 0.0f);
+    }
+
+    VF r = ((ax - y * 0.78515625f) - y * 2.4187564849853515625e-4f) - y * 3.77489497744594108e-8f;
+    VF z = r * r;
+    VF c = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+    VF s = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+    VF result = Select((j & 2) != 0, c, s);
+    return Select(sign, -result, result);
+  }
+
+  static inline void Sin(const VF *L, VF *D, size_t nv) {
+    for (size_t k = 0; k < nv; ++k) {
+      VF x = L[k];
+      VF result = SinCos(x, false);
+      VI fallback = (Abs(x) > 8192.0f) | NonFinite(x);
+      if (Any(fallback)) {
+        for (int i = 0; i < W; ++i) {
+          if (fallback[i]) result[i] = sin(x[i]);
+        }
+      }
+      D[k] = result;
+    }
+  }
+
+  static inline void Cos(const VF *L, VF *D, size_t nv) {
+    for (size_t k = 0; k < nv; ++k) {
+      VF x = L[k];
+      VF result = SinCos(x, true);
+      VI fallback = (Abs(x) > 8192.0f) | NonFinite(x);
+      if (Any(fallback)) {
+        for (int i = 0; i < W; ++i) {
+          if (fallback[i]) result[i] = cos(x[i]);
+        }
+      }
+      D[k] = result;
+    }
+  }
+
+  // Cephes logf for positive normal x.
+  static inline VF LogPositive(VF x) {
+    VI bits = (VI)x;
+    VF e = __builtin_convertvector(((bits >> 23) & 0xff) - 126, VF);
+    VF m = (VF)((bits & 0x807fffff) | 0x3f000000);
+    VI small = m < 0.707106781186547524f;
+    e = Select(small, e - 1.0f, e);
+    m = Select(small, m + m - 1.0f, m - 1.0f);
+
+    VF z = m * m;
+    VF y = Splat(7.0376836292e-2f);
+    y = y * m - 1.1514610310e-1f;
+    y = y * m + 1.1676998740e-1f;
+    y = y * m - 1.2420140846e-1f;
+    y = y * m + 1.4249322787e-1f;
+    y = y * m - 1.6668057665e-1f;
+    y = y * m + 2.0000714765e-1f;
+    y = y * m - 2.4999993993e-1f;
+    y = y * m + 3.3333331174e-1f;
+    y = y * m * z;
+    y += -2.12194440e-4f * e;
+    y += -0.5f * z;
+    return m + y + 0.693359375f * e;
+  }
+
+  // Lanes for which LogPositive is not valid: zero, negative, denormal,
+  // infinite or NaN.
+  static inline VI LogFallback(VF x) {
+    return (x < 1.17549435e-38f) | NonFinite(x);
+  }
+
+  static inline void Log(const VF *L, VF *D, size_t nv) {
+    for (size_t k = 0; k < nv; ++k) {
+      VF x = L[k];
+      VI fallback = LogFallback(x);
+      VF result = LogPositive(Select(fallback, Splat(1.0f), x));
+      if (Any(fallback)) {
+        for (int i = 0; i < W; ++i) {
+          if (fallback[i]) result[i] = log(x[i]);
+        }
+      }
+      D[k] = result;
+    }
+  }
+
+  // Cephes expf for x in [-87.3, 88.3], where 2^n stays a normal float.
+  static inline VF ExpInRange(VF x) {
+    VF fx = Floor(x * 1.44269504088896341f + 0.5f);
+    x = x - fx * 0.693359375f;
+    x = x - fx * -2.12194440e-4f;
+    VF z = x * x;
+    VF y = Splat(1.9875691500e-4f);
+    y = y * x + 1.3981999507e-3f;
+    y = y * x + 8.3334519073e-3f;
+    y = y * x + 4.1665795894e-2f;
+    y = y * x + 1.6666665459e-1f;
+    y = y * x + 5.0000001201e-1f;
+    y = y * z + x + 1.0f;
+    VI n = __builtin_convertvector(fx, VI);
+    VF scale = (VF)((n + 127) << 23);
+    return y * scale;
+  }
+
+  // x^n by repeated squaring for integer exponents with |n| <= 16.
+  static inline VF PowInteger(VF x, VI n) {
+    VI e = (n ^ (n >> 31)) - (n >> 31);
+    VF result = Splat(1.0f);
+    VF base = x;
+    for (int bit = 0; bit < 5; ++bit) {
+      result = Select((e & 1) != 0, result * base, result);
+      base = base * base;
+      e = e >> 1;
+    }
+    return Select(n < 0, 1.0f / result, result);
+  }
+
+  static inline void Pow(const VF *L, const VF *R, VF *D, size_t nv) {
+    for (size_t k = 0; k < nv; ++k) {
+      VF x = L[k];
+      VF y = R[k];
+      VF ax = Abs(x);
+
+      // Negative bases are only defined for integer exponents, where the
+      // sign of the result follows the parity of the exponent.
+      VI yi = __builtin_convertvector(y, VI);
+      VI isInteger = (Abs(y) < 8388608.0f) & (__builtin_convertvector(yi, VF) == y);
+      VI smallInteger = isInteger & (Abs(y) <= 16.0f);
+      VI negative = x < 0.0f;
+      VI odd = (yi & 1) != 0;
+
+      VI fallback = LogFallback(ax) | NonFinite(y);
+      VF t = y * LogPositive(Select(fallback, Splat(1.0f), ax));
+      VF general = ExpInRange(Select(fallback | smallInteger, Splat(0.0f), t));
+      VF integer = PowInteger(Select(fallback, Splat(1.0f), ax), yi & smallInteger);
+      VF result = Select(smallInteger, integer, general);
+
+      // Results that over- or underflow are left to the scalar pow.
+      VI outOfRange = (t < -87.3f) | (t > 88.3f);
+      VI integerOutOfRange = (integer == 0.0f) | NonFinite(integer);
+      fallback = fallback | (smallInteger & integerOutOfRange) | (~smallInteger & outOfRange);
+
+      result = Select(negative & isInteger & odd, -result, result);
+      result = Select(negative & ~isInteger, Splat(__builtin_nanf("")), result);
+
+      if (Any(fallback)) {
+        for (int i = 0; i < W; ++i) {
+          if (fallback[i]) result[i] = pow(x[i], y[i]);
+        }
+      }
+      D[k] = result;
+    }
+  }
+
+  static void EvalBatch(const Program &program, float divThreshold, const float *xs, const float *ys, const float *zs, size_t n, float *const *results) {
+    const size_t B = Program::BatchSize;
+    const size_t V = B / W;
+
+    // The register file is carved out of a float buffer aligned for VF so
+    // that no container code is instantiated for the vector type.
+    vector<float> storage((program.NumRegisters + 3) * B + W);
+    size_t misalignment = (size_t)storage.data() % sizeof(VF);
+    float *base = storage.data() + (misalignment ? (sizeof(VF) - misalignment) / sizeof(float) : 0);
+    VF *registerFile = (VF *)base;
+    VF *X = registerFile + program.NumRegisters * V;
+    VF *Y = X + V;
+    VF *Z = Y + V;
+
+    for (size_t start = 0; start < n; start += B) {
+      const size_t count = n - start < B ? n - start : B;
+      const size_t nv = (count + W - 1) / W;
+
+      // Pad the last vector with ones, which every kernel handles without
+      // falling back to scalar code.
+      for (size_t i = count; i < nv * W; ++i) {
+        ((float *)X)[i] = 1.0f;
+        ((float *)Y)[i] = 1.0f;
+        ((float *)Z)[i] = 1.0f;
+      }
+      memcpy(X, xs + start, count * sizeof(float));
+      memcpy(Y, ys + start, count * sizeof(float));
+      memcpy(Z, zs + start, count * sizeof(float));
+
+      for (const Instruction &I : program.Code) {
+        VF *D = registerFile + I.Dst * V;
+        const VF *L = registerFile + I.A * V;
+        const VF *R = registerFile + I.B * V;
+        switch (I.Op) {
+          case OpCode::ConstOp: {
+            VF c = Splat(I.Imm);
+            for (size_t k = 0; k < nv; ++k) D[k] = c;
+            break;
+          }
+          case OpCode::XOp:
+            for (size_t k = 0; k < nv; ++k) D[k] = X[k];
+            break;
+          case OpCode::YOp:
+            for (size_t k = 0; k < nv; ++k) D[k] = Y[k];
+            break;
+          case OpCode::ZOp:
+            for (size_t k = 0; k < nv; ++k) D[k] = Z[k];
+            break;
+          case OpCode::NegOp:
+            for (size_t k = 0; k < nv; ++k) D[k] = -1.0f * L[k];
+            break;
+          case OpCode::AddOp:
+            for (size_t k = 0; k < nv; ++k) D[k] = L[k] + R[k];
+            break;
+          case OpCode::SubOp:
+            for (size_t k = 0; k < nv; ++k) D[k] = L[k] - R[k];
+            break;
+          case OpCode::MultOp:
+            for (size_t k = 0; k < nv; ++k) D[k] = L[k] * R[k];
+            break;
+          case OpCode::DivOp:
+            for (size_t k = 0; k < nv; ++k) {
+              VF r = R[k];
+              D[k] = Select(r <= divThreshold, Splat(1000000000.0f), L[k] / r);
+            }
+            break;
+          case OpCode::PowOp:
+            Pow(L, R, D, nv);
+            break;
+          case OpCode::SinOp:
+            Sin(L, D, nv);
+            break;
+          case OpCode::CosOp:
+            Cos(L, D, nv);
+            break;
+          case OpCode::LogOp:
+            Log(L, D, nv);
+            break;
+        }
+      }
+
+      for (size_t o = 0; o < program.Outputs.size(); ++o) {
+        memcpy(results[o] + start, registerFile + program.Outputs[o] * V, count * sizeof(float));
+      }
+    }
+  }
+}
@@ -0,0 +1,384 @@
+#include "Simplifier.h"
+#include <algorithm>
+
+using namespace Expression;
+
+static bool IsInteger(float f) {
+  return f == floor(f) && fabs(f) < 16777216.0f;
+}
+
+// Divides like Div::Eval does.
+static float Quotient(float l, float r) {
+  if (r <= 0.00001) {
+    return 1000000000.0;
+  }
+  return l / r;
+}
+
+// Compares A and B, caching results in memo if given.
+static int CompareNodes(Expr *A, Expr *B, Simplifier::CompareCache *memo) {
+  if (A == B) return 0;
+  if (A->Kind != B->Kind) return A->Kind < B->Kind ? -1 : 1;
+  if (A->Kind == ExprKind::ValKind) {
+    float a = static_cast<Val *>(A)->V;
+    float b = static_cast<Val *>(B)->V;
+    // NaN (e.g. a folded log of a negative) comes after every number and
+    // ties with every NaN, which keeps the order strict weak.
+    if (isnan(a) || isnan(b)) return (int)isnan(a) - (int)isnan(b);
+    if (a == b) return 0;
+    return a < b ? -1 : 1;
+  }
+  if (memo) {
+    auto It = memo->find({A, B});
+    if (It != memo->end()) return It->second;
+  }
+  Expr **A1, **A2, **B1, **B2;
+  size_t numChildren = ChildSlots(A, A1, A2);
+  ChildSlots(B, B1, B2);
+  int result = 0;
+  if (numChildren > 0) {
+    result = CompareNodes(*A1, *B1, memo);
+  }
+  if (result == 0 && numChildren > 1) {
+    result = CompareNodes(*A2, *B2, memo);
+  }
+  if (memo) {
+    (*memo)[{A, B}] = result;
+    (*memo)[{B, A}] = -result;
+  }
+  return result;
+}
+
+int Expression::Compare(Expr *A, Expr *B) {
+  return CompareNodes(A, B, nullptr);
+}
+
+int Simplifier::Order(Expr *A, Expr *B) {
+  return CompareNodes(A, B, &compared);
+}
+
+Expr *Simplifier::Simplify(Expr *E) {
+  Expr *Current = interner.Intern(E->Simplify());
+  for (int iteration = 0; iteration < MaxIterations; ++iteration) {
+    rewritten.clear();
+    Expr *Next = Rewrite(Current);
+    bool changed = Next != Current;
+    Current = Next;
+    if (!changed) break;
+  }
+  rewritten.clear();
+  compared.clear();
+  return Current;
+}
+
+Expr *Simplifier::Constant(float value, int precision) {
+  if (value == 0) {
+    // Avoid displaying -0
+    return Make<Val>(0.0f, precision);
+  }
+  if (!IsInteger(value) && precision < 2) {
+    precision = 2;
+  }
+  return Make<Val>(value, precision);
+}
+
+Expr *Simplifier::Rewrite(Expr *E) {
+  auto It = rewritten.find(E);
+  if (It != rewritten.end()) {
+    return It->second;
+  }
+
+  Expr *Result = E;
+  switch (E->Kind) {
+    case ExprKind::AddKind:
+    case ExprKind::SubKind:
+    case ExprKind::NegKind:
+      Result = RewriteSum(E);
+      break;
+    case ExprKind::MultKind:
+      Result = RewriteProduct(E);
+      break;
+    case ExprKind::DivKind:
+      Result = RewriteQuotient(static_cast<Div *>(E));
+      break;
+    case ExprKind::PowKind:
+      Result = RewritePow(static_cast<Pow *>(E));
+      break;
+    case ExprKind::SinKind:
+    case ExprKind::CosKind:
+    case ExprKind::LogKind:
+      Result = RewriteFunction(E);
+      break;
+    default:
+      break;
+  }
+  rewritten[E] = Result;
+  return Result;
+}
+
+void Simplifier::CollectTerms(Expr *E, float sign, vector<Term> &terms, float &constant, int &precision) {
+  switch (E->Kind) {
+    case ExprKind::AddKind: {
+      Add *A = static_cast<Add *>(E);
+      CollectTerms(Rewrite(A->Left), sign, terms, constant, precision);
+      CollectTerms(Rewrite(A->Right), sign, terms, constant, precision);
+      return;
+    }
+    case ExprKind::SubKind: {
+      Sub *S = static_cast<Sub *>(E);
+      CollectTerms(Rewrite(S->Left), sign, terms, constant, precision);
+      CollectTerms(Rewrite(S->Right), -sign, terms, constant, precision);
+      return;
+    }
+    case ExprKind::NegKind:
+      CollectTerms(Rewrite(static_cast<Neg *>(E)->Child), -sign, terms, constant, precision);
+      return;
+    case ExprKind::ValKind: {
+      Val *V = static_cast<Val *>(E);
+      constant += sign * V->V;
+      precision = max(precision, V->P);
+      return;
+    }
+    case ExprKind::MultKind: {
+      // Products are rewritten with their coefficient on the left.
+      Mult *M = static_cast<Mult *>(E);
+      if (M->Left->Kind == ExprKind::ValKind) {
+        Val *V = static_cast<Val *>(M->Left);
+        precision = max(precision, V->P);
+        terms.push_back({sign * V->V, M->Right});
+        return;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  terms.push_back({sign, E});
+}
+
+Expr *Simplifier::RewriteSum(Expr *E) {
+  vector<Term> terms;
+  float constant = 0;
+  int constantPrecision = 0;
+  CollectTerms(E, 1, terms, constant, constantPrecision);
+
+  // Like terms end up next to each other.
+  stable_sort(terms.begin(), terms.end(), [this](const Term &a, const Term &b) {
+    return Order(a.Rest, b.Rest) < 0;
+  });
+  vector<Term> combined;
+  for (const Term &term : terms) {
+    if (!combined.empty() && Order(combined.back().Rest, term.Rest) == 0) {
+      combined.back().Coefficient += term.Coefficient;
+    } else {
+      combined.push_back(term);
+    }
+  }
+
+  Expr *Result = nullptr;
+  for (const Term &term : combined) {
+    float c = term.Coefficient;
+    if (c == 0) continue;
+    Expr *Piece = term.Rest;
+    if (fabs(c) != 1) {
+      Piece = Make<Mult>(Constant(fabs(c), constantPrecision), Piece);
+    }
+    if (!Result) {
+      Result = c < 0 ? Make<Neg>(Piece) : Piece;
+    } else if (c < 0) {
+      Result = Make<Sub>(Result, Piece);
+    } else {
+      Result = Make<Add>(Result, Piece);
+    }
+  }
+
+  if (!Result) {
+    return Constant(constant, constantPrecision);
+  }
+  if (constant > 0) {
+    Result = Make<Add>(Result, Constant(constant, constantPrecision));
+  } else if (constant < 0) {
+    Result = Make<Sub>(Result, Constant(-constant, constantPrecision));
+  }
+  return Result;
+}
+
+void Simplifier::CollectFactors(Expr *E, vector<Factor> &factors, float &coefficient, int &precision) {
+  switch (E->Kind) {
+    case ExprKind::MultKind: {
+      Mult *M = static_cast<Mult *>(E);
+      CollectFactors(Rewrite(M->Left), factors, coefficient, precision);
+      CollectFactors(Rewrite(M->Right), factors, coefficient, precision);
+      return;
+    }
+    case ExprKind::NegKind:
+      coefficient = -coefficient;
+      CollectFactors(Rewrite(static_cast<Neg *>(E)->Child), factors, coefficient, precision);
+      return;
+    case ExprKind::ValKind: {
+      Val *V = static_cast<Val *>(E);
+      coefficient *= V->V;
+      precision = max(precision, V->P);
+      return;
+    }
+    case ExprKind::PowKind: {
+      Pow *P = static_cast<Pow *>(E);
+      float exponent;
+      if (P->Right->NumericValue(exponent) && IsInteger(exponent)) {
+        factors.push_back({P->Left, exponent});
+        return;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  factors.push_back({E, 1});
+}
+
+Expr *Simplifier::RewriteProduct(Expr *E) {
+  vector<Factor> factors;
+  float coefficient = 1;
+  int coefficientPrecision = 0;
+  CollectFactors(E, factors, coefficient, coefficientPrecision);
+  if (coefficient == 0) {
+    return Constant(0, 0);
+  }
+
+  // Like factors end up next to each other.
+  stable_sort(factors.begin(), factors.end(), [this](const Factor &a, const Factor &b) {
+    return Order(a.Base, b.Base) < 0;
+  });
+  vector<Factor> combined;
+  for (const Factor &factor : factors) {
+    if (!combined.empty() && Order(combined.back().Base, factor.Base) == 0) {
+      combined.back().Exponent += factor.Exponent;
+    } else {
+      combined.push_back(factor);
+    }
+  }
+
+  Expr *Result = nullptr;
+  for (const Factor &factor : combined) {
+    if (factor.Exponent == 0) continue;
+    Expr *Piece = factor.Base;
+    if (factor.Exponent != 1) {
+      Piece = Make<Pow>(Piece, Constant(factor.Exponent, 0));
+    }
+    Result = Result ? Make<Mult>(Result, Piece) : Piece;
+  }
+
+  if (!Result) {
+    return Constant(coefficient, coefficientPrecision);
+  }
+  if (fabs(coefficient) != 1) {
+    Result = Make<Mult>(Constant(fabs(coefficient), coefficientPrecision), Result);
+  }
+  return coefficient < 0 ? Make<Neg>(Result) : Result;
+}
+
+Expr *Simplifier::RewriteQuotient(Div *E) {
+  Expr *L = Rewrite(E->Left);
+  Expr *R = Rewrite(E->Right);
+  float l, r;
+  bool numericLeft = L->NumericValue(l);
+  bool numericRight = R->NumericValue(r);
+  if (numericLeft && numericRight) {
+    int p = 0;
+    if (L->Kind == ExprKind::ValKind) p = max(p, static_cast<Val *>(L)->P);
+    if (R->Kind == ExprKind::ValKind) p = max(p, static_cast<Val *>(R)->P);
+    return Constant(Quotient(l, r), p);
+  }
+  if (numericRight && r == 1) {
+    // e/1 == e
+    return L;
+  }
+  if (numericLeft && l == 0) {
+    // 0/e == 0
+    return Constant(0, 0);
+  }
+  if (L == E->Left && R == E->Right) {
+    return E;
+  }
+  return Make<Div>(L, R);
+}
+
+Expr *Simplifier::RewritePow(Pow *E) {
+  Expr *L = Rewrite(E->Left);
+  Expr *R = Rewrite(E->Right);
+  float l, r;
+  bool numericLeft = L->NumericValue(l);
+  bool numericRight = R->NumericValue(r);
+  if (numericLeft && numericRight) {
+    int p = 0;
+    if (L->Kind == ExprKind::ValKind) p = static_cast<Val *>(L)->P;
+    return Constant(pow(l, r), p);
+  }
+  if (numericRight && r == 0) {
+    // e^0 == 1
+    return Constant(1, 0);
+  }
+  if (numericRight && r == 1) {
+    // e^1 == e
+    return L;
+  }
+  if (numericLeft && l == 1) {
+    // 1^e == 1
+    return Constant(1, 0);
+  }
+  if (numericLeft && l == 0 && numericRight && r > 0) {
+    // 0^n == 0 for positive n
+    return Constant(0, 0);
+  }
+  if (L->Kind == ExprKind::PowKind && numericRight && IsInteger(r)) {
+    // (e^m)^n == e^(mn) for integer m and n
+    Pow *Inner = static_cast<Pow *>(L);
+    float m;
+    if (Inner->Right->NumericValue(m) && IsInteger(m)) {
+      return Make<Pow>(Inner->Left, Constant(m * r, 0));
+    }
+  }
+  if (L == E->Left && R == E->Right) {
+    return E;
+  }
+  return Make<Pow>(L, R);
+}
+
+Expr *Simplifier::RewriteFunction(Expr *E) {
+  Expr **Slot, **Unused;
+  ChildSlots(E, Slot, Unused);
+  Expr *Child = Rewrite(*Slot);
+  float v;
+  if (Child->NumericValue(v)) {
+    int p = Child->Kind == ExprKind::ValKind ? static_cast<Val *>(Child)->P : 2;
+    switch (E->Kind) {
+      case ExprKind::SinKind: return Constant(sin(v), p);
+      case ExprKind::CosKind: return Constant(cos(v), p);
+      default: return Constant(log(v), p);
+    }
+  }
+  if (Child->Kind == ExprKind::NegKind) {
+    Expr *Inner = static_cast<Neg *>(Child)->Child;
+    if (E->Kind == ExprKind::SinKind) {
+      // sin(-e) == -sin(e)
+      return Make<Neg>(Make<Sin>(Inner));
+    }
+    if (E->Kind == ExprKind::CosKind) {
+      // cos(-e) == cos(e)
+      return Make<Cos>(Inner);
+    }
+  }
+  if (Child == *Slot) {
+    return E;
+  }
+  switch (E->Kind) {
+    case ExprKind::SinKind: return Make<Sin>(Child);
+    case ExprKind::CosKind: return Make<Cos>(Child);
+    default: return Make<Log>(Child);
+  }
+}
+
+Expr *Expression::Simplify(Expr *E) {
+  Simplifier simplifier;
+  return simplifier.Simplify(E);
+}
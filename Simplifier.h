@@ -0,0 +1,84 @@
+#ifndef VECTORFIELD_SIMPLIFIER
+#define VECTORFIELD_SIMPLIFIER
+#include "Expr.h"
+#include "Intern.h"
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace Expression {
+  // Rewrite-rule simplifier that is applied repeatedly until the expression
+  // stops changing. On top of what Expr::Simplify does it
+  //   - flattens chains of + and - into one sum and chains of * into one
+  //     product, sorts their operands into a canonical order and folds their
+  //     constants into a single coefficient,
+  //   - combines like terms (x + 2x = 3x) and like factors (x * x = x^2,
+  //     x^2 * x = x^3) with integer exponents,
+  //   - folds constants in ^, ln, sin and cos and applies identities such as
+  //     e^0 = 1, e^1 = e, 0^n = 0, 1^n = 1, sin(0) = 0 and cos(-e) = cos(e).
+  // Quotients are only simplified within their operands, because Div clamps
+  // small and negative denominators. The nodes worked on are interned, so
+  // subtrees of E may have their child pointers rewritten in place.
+  class Simplifier {
+  public:
+    Expr *Simplify(Expr *E);
+
+    static const int MaxIterations = 16;
+
+    struct PairHash {
+      size_t operator()(const pair<Expr *, Expr *> &p) const {
+        return hash<Expr *>()(p.first) * 31 + hash<Expr *>()(p.second);
+      }
+    };
+    // Results of Compare by pair of nodes.
+    typedef unordered_map<pair<Expr *, Expr *>, int, PairHash> CompareCache;
+
+  private:
+    struct Term {
+      float Coefficient;
+      Expr *Rest;
+    };
+    struct Factor {
+      Expr *Base;
+      float Exponent;
+    };
+
+    // Every node the simplifier works on is interned, so structurally equal
+    // subtrees are the same node: a pass that changes nothing returns the
+    // node it was given, and Compare results can be cached per pair.
+    Interner interner;
+    CompareCache compared;
+    // Rewritten form of each node visited in the current pass. Derivative
+    // trees share subtrees, which are rewritten only once this way.
+    unordered_map<Expr *, Expr *> rewritten;
+
+    // Compare on interned nodes, memoized.
+    int Order(Expr *A, Expr *B);
+    // Interned node of the given type.
+    template <typename Node, typename... Args>
+    Expr *Make(Args... args) {
+      return interner.Intern(new Node(args...));
+    }
+
+    Expr *Rewrite(Expr *E);
+    Expr *RewriteSum(Expr *E);
+    Expr *RewriteProduct(Expr *E);
+    Expr *RewriteQuotient(Div *E);
+    Expr *RewritePow(Pow *E);
+    Expr *RewriteFunction(Expr *E);
+    // Both also track the largest precision among the folded constants,
+    // which is used to display the result.
+    void CollectTerms(Expr *E, float sign, vector<Term> &terms, float &constant, int &precision);
+    void CollectFactors(Expr *E, vector<Factor> &factors, float &coefficient, int &precision);
+    Expr *Constant(float value, int precision);
+  };
+
+  // Total order on expressions, used for canonical ordering. Returns a
+  // negative, zero or positive value; zero means structurally equal.
+  extern int Compare(Expr *A, Expr *B);
+
+  extern Expr *Simplify(Expr *E);
+}
+
+#endif
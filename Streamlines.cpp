@@ -0,0 +1,188 @@
+#include "Streamlines.h"
+#include <math.h>
+
+vector<Vec3> Seeds::Grid(Vec3 min, Vec3 max, int countX, int countY, int countZ) {
+  // A single point along an axis sits in the middle of it.
+  auto along = [](float low, float high, int i, int count) {
+    return count <= 1 ? 0.5f * (low + high) : low + (high - low) * i / (count - 1);
+  };
+  vector<Vec3> seeds;
+  for (int i = 0; i < countX; ++i) {
+    for (int j = 0; j < countY; ++j) {
+      for (int k = 0; k < countZ; ++k) {
+        seeds.push_back({along(min.x, max.x, i, countX), along(min.y, max.y, j, countY), along(min.z, max.z, k, countZ)});
+      }
+    }
+  }
+  return seeds;
+}
+
+vector<Vec3> Seeds::Line(Vec3 start, Vec3 end, int count) {
+  return Plane(start, Vector::GetVector(start, end), {0, 0, 0}, count, 1);
+}
+
+vector<Vec3> Seeds::Plane(Vec3 origin, Vec3 u, Vec3 v, int countU, int countV) {
+  vector<Vec3> seeds;
+  for (int i = 0; i < countU; ++i) {
+    float a = countU <= 1 ? 0 : (float)i / (countU - 1);
+    for (int j = 0; j < countV; ++j) {
+      float b = countV <= 1 ? 0 : (float)j / (countV - 1);
+      seeds.push_back({origin.x + a * u.x + b * v.x, origin.y + a * u.y + b * v.y, origin.z + a * u.z + b * v.z});
+    }
+  }
+  return seeds;
+}
+
+// p + h * (sum of c[i] * k[i]).
+static inline Vec3 Combine(Vec3 p, float h, const Vec3 *k, const float *c, int n) {
+  Vec3 result = p;
+  for (int i = 0; i < n; ++i) {
+    result.x += h * c[i] * k[i].x;
+    result.y += h * c[i] * k[i].y;
+    result.z += h * c[i] * k[i].z;
+  }
+  return result;
+}
+
+// Dormand-Prince tableau. The last stage is evaluated at the new point, so
+// it is the first stage of the next step.
+static const float dpA[6][6] = {
+  {1.0f / 5},
+  {3.0f / 40, 9.0f / 40},
+  {44.0f / 45, -56.0f / 15, 32.0f / 9},
+  {19372.0f / 6561, -25360.0f / 2187, 64448.0f / 6561, -212.0f / 729},
+  {9017.0f / 3168, -355.0f / 33, 46732.0f / 5247, 49.0f / 176, -5103.0f / 18656},
+  {35.0f / 384, 0, 500.0f / 1113, 125.0f / 192, -2187.0f / 6784, 11.0f / 84}
+};
+// Fifth-order weights minus the embedded fourth-order ones.
+static const float dpE[7] = {
+  71.0f / 57600, 0, -71.0f / 16695, 71.0f / 1920, -17253.0f / 339200, 22.0f / 525, -1.0f / 40
+};
+static const float rk4Weights[4] = {1.0f / 6, 1.0f / 3, 1.0f / 3, 1.0f / 6};
+
+// Traces from seed along the field (sign 1) or against it (sign -1), writing
+// the seed and each point after it stride entries apart. Returns the number
+// of points written.
+static size_t Trace(VectorField &field, Vec3 seed, float sign, const StreamlineOptions &options, Vec3 *points, float *speeds, ptrdiff_t stride) {
+  // Unit direction of the field at p, or false where it has no direction.
+  auto direction = [&](Vec3 p, Vec3 &d, float &speed) {
+    Vec3 v = field.Eval(p.x, p.y, p.z);
+    speed = Vector::Length(v);
+    if (!(speed >= options.MinSpeed) || isinf(speed)) {
+      return false;
+    }
+    d = {sign * v.x / speed, sign * v.y / speed, sign * v.z / speed};
+    return true;
+  };
+  auto inside = [&](Vec3 p) {
+    return fabs(p.x) <= options.Bounds.x && fabs(p.y) <= options.Bounds.y && fabs(p.z) <= options.Bounds.z;
+  };
+
+  Vec3 p = seed;
+  Vec3 k[7];
+  float speed;
+  bool moving = inside(p) && direction(p, k[0], speed);
+  points[0] = p;
+  speeds[0] = moving ? speed : 0;
+  size_t count = 1;
+  float length = 0;
+  float h = options.Step;
+
+  while (moving && count < options.MaxPoints && length < options.MaxLength) {
+    Vec3 next;
+    float taken = h;
+    if (options.Method == Integrator::RK4) {
+      static const float one[1] = {1};
+      float stageSpeed;
+      moving = direction(Combine(p, 0.5f * h, &k[0], one, 1), k[1], stageSpeed) &&
+               direction(Combine(p, 0.5f * h, &k[1], one, 1), k[2], stageSpeed) &&
+               direction(Combine(p, h, &k[2], one, 1), k[3], stageSpeed);
+      if (!moving) break;
+      next = Combine(p, h, k, rk4Weights, 4);
+      if (!inside(next)) break;
+      // The direction at next starts the following step.
+      moving = direction(next, k[0], speed);
+    } else {
+      // Shrinks the step until its error estimate is within tolerance.
+      while (true) {
+        for (int stage = 1; stage <= 6 && moving; ++stage) {
+          moving = direction(Combine(p, h, k, dpA[stage - 1], stage), k[stage], speed);
+        }
+        if (!moving) break;
+        float error = Vector::Length(Combine({0, 0, 0}, h, k, dpE, 7));
+        float scale = error > 0 ? 0.9f * powf(options.Tolerance / error, 0.2f) : 5.0f;
+        scale = MathUtils::Clamp(scale, 0.2f, 5.0f);
+        bool accepted = error <= options.Tolerance || h <= options.MinStep;
+        taken = h;
+        h = MathUtils::Clamp(h * scale, options.MinStep, options.MaxStep);
+        if (accepted) break;
+      }
+      if (!moving) break;
+      next = Combine(p, taken, k, dpA[5], 6);
+      if (!inside(next)) break;
+      // The last stage was evaluated at next, with its speed in speed.
+      k[0] = k[6];
+    }
+    p = next;
+    length += taken;
+    points[(ptrdiff_t)count * stride] = p;
+    speeds[(ptrdiff_t)count * stride] = speed;
+    ++count;
+  }
+  return count;
+}
+
+bool TraceStreamlines(VectorField &field, const vector<Vec3> &seeds, const StreamlineOptions &options, Streamlines &lines, size_t numThreads, const atomic<bool> *cancel) {
+  lines.Points.clear();
+  lines.Speeds.clear();
+  lines.Offsets.assign(1, 0);
+  size_t maxPoints = max<size_t>(options.MaxPoints, 1);
+
+  // Every seed gets a fixed slot with the seed in the middle: forward points
+  // after it and backward points before it. The slots are compacted into
+  // lines once every seed is done.
+  size_t slotSize = 2 * maxPoints - 1;
+  vector<Vec3> slotPoints(seeds.size() * slotSize);
+  vector<float> slotSpeeds(seeds.size() * slotSize);
+  vector<size_t> firsts(seeds.size()), lasts(seeds.size());
+
+  StreamlineOptions limited = options;
+  limited.MaxPoints = maxPoints;
+  atomic<bool> cancelled(false);
+  auto traceSeed = [&](size_t seed) {
+    if (cancel && cancel->load(memory_order_relaxed)) {
+      cancelled = true;
+      return;
+    }
+    size_t middle = seed * slotSize + maxPoints - 1;
+    size_t forward = Trace(field, seeds[seed], 1, limited, &slotPoints[middle], &slotSpeeds[middle], 1);
+    size_t backward = options.Backward ? Trace(field, seeds[seed], -1, limited, &slotPoints[middle], &slotSpeeds[middle], -1) : 1;
+    firsts[seed] = middle - (backward - 1);
+    lasts[seed] = middle + forward;
+  };
+
+  if (numThreads == 1) {
+    for (size_t seed = 0; seed < seeds.size(); ++seed) {
+      traceSeed(seed);
+    }
+  } else {
+    ThreadPool::Shared().ParallelFor(seeds.size(), traceSeed, numThreads);
+  }
+  if (cancelled) {
+    return false;
+  }
+
+  size_t total = 0;
+  for (size_t seed = 0; seed < seeds.size(); ++seed) {
+    total += lasts[seed] - firsts[seed];
+  }
+  lines.Points.reserve(total);
+  lines.Speeds.reserve(total);
+  for (size_t seed = 0; seed < seeds.size(); ++seed) {
+    if (lasts[seed] - firsts[seed] < 2) continue;
+    lines.Points.insert(lines.Points.end(), slotPoints.begin() + firsts[seed], slotPoints.begin() + lasts[seed]);
+    lines.Speeds.insert(lines.Speeds.end(), slotSpeeds.begin() + firsts[seed], slotSpeeds.begin() + lasts[seed]);
+    lines.Offsets.push_back(lines.Points.size());
+  }
+  return true;
+}
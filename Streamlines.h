@@ -0,0 +1,70 @@
+#ifndef VECTORFIELD_STREAMLINES
+#define VECTORFIELD_STREAMLINES
+#include "VectorField.h"
+#include "Utils/MathUtils.h"
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+enum class Integrator {
+  // Classic fourth-order Runge-Kutta with a fixed step.
+  RK4,
+  // Dormand-Prince 5(4): fifth-order steps whose size follows the
+  // difference to the embedded fourth-order solution.
+  DormandPrince
+};
+
+struct StreamlineOptions {
+  Integrator Method = Integrator::RK4;
+  // Step length for RK4, and the first step for Dormand-Prince. Lines
+  // follow the direction of the field, so steps are measured in distance.
+  float Step = 0.05f;
+  // Dormand-Prince only: largest error allowed per step, and the limits of
+  // the step length.
+  float Tolerance = 0.0005f;
+  float MinStep = 0.0005f;
+  float MaxStep = 0.5f;
+  // Each direction of a line stops after MaxPoints points, MaxLength
+  // distance, outside [-Bounds, Bounds], or where the field is shorter
+  // than MinSpeed.
+  size_t MaxPoints = 500;
+  float MaxLength = 50;
+  Vec3 Bounds = {10, 10, 10};
+  float MinSpeed = 0.000001f;
+  // Trace against the field from each seed as well as along it.
+  bool Backward = true;
+};
+
+// Polylines stored back to back. Line i is the points from Offsets[i] up to
+// (not including) Offsets[i + 1].
+struct Streamlines {
+  vector<Vec3> Points;
+  // Length of the field at each point.
+  vector<float> Speeds;
+  vector<size_t> Offsets;
+
+  size_t NumLines() const { return Offsets.empty() ? 0 : Offsets.size() - 1; }
+};
+
+// Seed sets for TraceStreamlines.
+namespace Seeds {
+  // countX by countY by countZ points spread evenly over the box.
+  vector<Vec3> Grid(Vec3 min, Vec3 max, int countX, int countY, int countZ);
+  // count points evenly spaced from start to end.
+  vector<Vec3> Line(Vec3 start, Vec3 end, int count);
+  // countU by countV points of the parallelogram origin + a * u + b * v,
+  // a and b in [0, 1].
+  vector<Vec3> Plane(Vec3 origin, Vec3 u, Vec3 v, int countU, int countV);
+}
+
+// Traces a streamline through each seed, spread over up to numThreads
+// threads of the shared pool (all of them for 0, the calling thread only for
+// 1). Lines come out in seed order, and the same for any thread count;
+// seeds whose line has fewer than two points are left out. Nothing is
+// allocated per step. Returns false, with lines undefined, if cancel was set
+// before every line was traced.
+extern bool TraceStreamlines(VectorField &field, const vector<Vec3> &seeds, const StreamlineOptions &options, Streamlines &lines, size_t numThreads = 0, const atomic<bool> *cancel = nullptr);
+
+#endif
@@ -0,0 +1,93 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(size_t numThreads) {
+  for (size_t i = 0; i < numThreads; ++i) {
+    workers.emplace_back([this]() { Work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Submit(function<void()> task) {
+  if (workers.empty()) {
+    task();
+    return;
+  }
+  {
+    lock_guard<mutex> guard(lock);
+    tasks.push_back(move(task));
+  }
+  wake.notify_one();
+}
+
+void ThreadPool::Work() {
+  while (true) {
+    function<void()> task;
+    {
+      unique_lock<mutex> guard(lock);
+      wake.wait(guard, [this]() { return stopping || !tasks.empty(); });
+      if (tasks.empty()) return;
+      task = move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+void ThreadPool::ParallelFor(size_t count, const function<void(size_t)> &task, size_t maxThreads) {
+  if (count == 0) return;
+  size_t numThreads = workers.size() + 1;
+  if (maxThreads > 0 && maxThreads < numThreads) numThreads = maxThreads;
+  if (numThreads > count) numThreads = count;
+
+  // Helpers may only get to run after every index is done (e.g. when the
+  // workers are busy), so the state they use is kept alive by them rather
+  // than by this call. They never call task once the indices run out.
+  struct State {
+    const function<void(size_t)> *Task;
+    size_t Count;
+    atomic<size_t> Next{0};
+    atomic<size_t> Done{0};
+    mutex Lock;
+    condition_variable Finished;
+  };
+  shared_ptr<State> state = make_shared<State>();
+  state->Task = &task;
+  state->Count = count;
+
+  auto run = [](State &s) {
+    size_t i;
+    while ((i = s.Next.fetch_add(1)) < s.Count) {
+      (*s.Task)(i);
+      if (s.Done.fetch_add(1) + 1 == s.Count) {
+        lock_guard<mutex> guard(s.Lock);
+        s.Finished.notify_all();
+      }
+    }
+  };
+
+  for (size_t helper = 1; helper < numThreads; ++helper) {
+    Submit([state, run]() { run(*state); });
+  }
+  run(*state);
+
+  unique_lock<mutex> guard(state->Lock);
+  state->Finished.wait(guard, [&]() { return state->Done.load() == count; });
+}
+
+ThreadPool &ThreadPool::Shared() {
+  // Never destroyed, so that tasks still running at exit keep a valid pool.
+  static ThreadPool *pool = new ThreadPool(thread::hardware_concurrency());
+  return *pool;
+}
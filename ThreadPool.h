@@ -0,0 +1,47 @@
+#ifndef VECTORFIELD_THREADPOOL
+#define VECTORFIELD_THREADPOOL
+#include <stddef.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+// Fixed set of worker threads that run queued tasks in order.
+class ThreadPool {
+public:
+  // A pool without threads runs everything on the calling thread.
+  ThreadPool(size_t numThreads);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t NumThreads() const { return workers.size(); }
+
+  // Queues task to run on one of the workers.
+  void Submit(function<void()> task);
+
+  // Calls task(i) for every i in [0, count) and returns once all calls are
+  // done. The calling thread takes part, so at most maxThreads threads work
+  // on the indices at once (all workers plus the caller when maxThreads is
+  // 0). Indices are handed out one at a time in increasing order, but may
+  // finish in any order.
+  void ParallelFor(size_t count, const function<void(size_t)> &task, size_t maxThreads = 0);
+
+  // Pool shared by the whole program, with one worker per hardware thread.
+  static ThreadPool &Shared();
+
+private:
+  vector<thread> workers;
+  deque<function<void()>> tasks;
+  mutex lock;
+  condition_variable wake;
+  bool stopping = false;
+
+  void Work();
+};
+
+#endif
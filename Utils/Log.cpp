@@ -0,0 +1,6 @@
+#include "Utils/Log.h"
+#include <stdio.h>
+
+void StderrSink::Append(const string &message) {
+  fprintf(stderr, "%s\n", message.c_str());
+}
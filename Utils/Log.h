@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Destination for the debug and error messages of the core (lexer, parsers).
+// The core never depends on a particular UI; the Qt app collects messages
+// from its worker threads with a BufferSink and shows them in a QTextBrowser,
+// batch jobs can print or drop them.
+class LogSink {
+public:
+  virtual ~LogSink() {}
+  virtual void Append(const string &message) = 0;
+};
+
+// Writes each message as a line to stderr.
+class StderrSink : public LogSink {
+public:
+  void Append(const string &message);
+};
+
+// Keeps messages in memory, e.g. to hand them from a worker thread to the
+// thread that owns the UI.
+class BufferSink : public LogSink {
+public:
+  void Append(const string &message) { Messages.push_back(message); }
+  vector<string> Messages;
+};
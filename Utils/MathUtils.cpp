@@ -47,6 +47,13 @@ float Vector::Dot(Vec3 vector, Vec3 other) {
   return vector.x * other.x + vector.y * other.y + vector.z * other.z;
 }
 
+/**
+ * Returns the angle between two vectors in radians, or 0 if either is zero.
+ */
+float Vector::Angle(Vec3 vector, Vec3 other) {
+  return atan2f(Length(Cross(vector, other)), Dot(vector, other));
+}
+
 /**
  * Returns a Vec3 `distance` away from the start Vec3, in the direction of the end Vec3.
  */
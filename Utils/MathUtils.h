@@ -51,6 +51,7 @@ namespace Vector {
   Vec3 SetLength(Vec3 vector, float length);
   Vec3 Cross(Vec3 vector, Vec3 other);
   float Dot(Vec3 vector, Vec3 other);
+  float Angle(Vec3 vector, Vec3 other);
   Vec3 Vec3Along(Vec3 start, Vec3 end, float distance);
   Vec3 Perpendicular(Vec3 start, Vec3 end);
 }
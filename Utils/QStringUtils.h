@@ -0,0 +1,11 @@
+#pragma once
+#include "Utils/StringUtils.h"
+#include <QString>
+
+// Qt conversions for the strings built with StringUtils. Kept out of
+// StringUtils.h so that the core library does not depend on Qt.
+namespace StringUtils {
+  inline QString Fancy(string str) {
+    return QString(str.c_str());
+  }
+}
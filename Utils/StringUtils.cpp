@@ -40,7 +40,3 @@ string StringUtils::TrimZeroes(float f, int precision) {
   }
   return result;
 }
-
-QString StringUtils::Fancy(string str) {
-  return QString(str.c_str());
-}
@@ -1,6 +1,5 @@
 #pragma once
 #include <string>
-#include <QString>
 #include "Utils/MathUtils.h"
 #include "Expr.h"
 
@@ -15,5 +14,4 @@ namespace StringUtils {
   string Equation(string func, string v1 = "x", string v2 = "y", string v3 = "z");
   string Vec3String(Vec3 vec, string open = "{", string close = "}");
   string TrimZeroes(float f, int precision = 2);
-  QString Fancy(string str);
 }
\ No newline at end of file
@@ -17,27 +17,24 @@ QT += widgets core gui openglwidgets
 
 CONFIG+=sdk_no_version_check
 
+# The core is built separately by VectorCore.pro
+LIBS += -L$$OUT_PWD -lVectorCore
+PRE_TARGETDEPS += $$OUT_PWD/libVectorCore.a
+
 # Input
-HEADERS += Expr.h \
-           mainwidget.h \
-           Utils/MathUtils.h \
+HEADERS += mainwidget.h \
            oglwidget.h \
-           Parsing/Parser.h \
-           Parsing/ParserAlt.h \
-           Parsing/Lexer.h \
-           Utils/StringUtils.h \
-           VectorField.h \
-           Graphics/Number.h
-SOURCES += Expr.cpp \
-           main.cpp \
+           headless.h \
+           Utils/QStringUtils.h \
+           Graphics/Number.h \
+           Graphics/Arrows.h \
+           Graphics/Lines.h
+SOURCES += main.cpp \
            mainwidget.cpp \
-           Utils/MathUtils.cpp \
            oglwidget.cpp \
-           Parsing/Parser.cpp \
-           Parsing/ParserAlt.cpp \
-           Parsing/Lexer.cpp \
-           Utils/StringUtils.cpp \
-           VectorField.cpp \
-           Graphics/Number.cpp
+           headless.cpp \
+           Graphics/Number.cpp \
+           Graphics/Arrows.cpp \
+           Graphics/Lines.cpp
 
 ICON = isad.icns
\ No newline at end of file
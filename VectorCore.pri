@@ -0,0 +1,42 @@
+# Headless core: expressions, parsing, evaluation and vector field math.
+# Nothing in here may depend on Qt, OpenGL or GLUT.
+HEADERS += $$PWD/Expr.h \
+           $$PWD/ExprArena.h \
+           $$PWD/Bytecode.h \
+           $$PWD/Intern.h \
+           $$PWD/Simplifier.h \
+           $$PWD/SimdKernels.h \
+           $$PWD/SimdKernelsImpl.h \
+           $$PWD/ThreadPool.h \
+           $$PWD/VectorField.h \
+           $$PWD/VectorStore.h \
+           $$PWD/Streamlines.h \
+           $$PWD/FieldSampler.h \
+           $$PWD/Jobs.h \
+           $$PWD/Profiler.h \
+           $$PWD/Utils/Log.h \
+           $$PWD/Utils/MathUtils.h \
+           $$PWD/Utils/StringUtils.h \
+           $$PWD/Parsing/Lexer.h \
+           $$PWD/Parsing/Parser.h \
+           $$PWD/Parsing/ParserAlt.h \
+           $$PWD/Parsing/PrecedenceParser.h
+SOURCES += $$PWD/Expr.cpp \
+           $$PWD/ExprArena.cpp \
+           $$PWD/Bytecode.cpp \
+           $$PWD/Intern.cpp \
+           $$PWD/Simplifier.cpp \
+           $$PWD/SimdKernels.cpp \
+           $$PWD/ThreadPool.cpp \
+           $$PWD/VectorField.cpp \
+           $$PWD/Streamlines.cpp \
+           $$PWD/FieldSampler.cpp \
+           $$PWD/Jobs.cpp \
+           $$PWD/Profiler.cpp \
+           $$PWD/Utils/Log.cpp \
+           $$PWD/Utils/MathUtils.cpp \
+           $$PWD/Utils/StringUtils.cpp \
+           $$PWD/Parsing/Lexer.cpp \
+           $$PWD/Parsing/Parser.cpp \
+           $$PWD/Parsing/ParserAlt.cpp \
+           $$PWD/Parsing/PrecedenceParser.cpp
@@ -0,0 +1,13 @@
+######################################################################
+# Static library with the headless core of Vector Visualizer. Built
+# without Qt so that it can be linked into tools and batch jobs.
+######################################################################
+
+TEMPLATE = lib
+TARGET = VectorCore
+CONFIG += staticlib c++17 sdk_no_version_check
+CONFIG -= qt app_bundle
+INCLUDEPATH += .
+MAKEFILE = Makefile.VectorCore
+
+include(VectorCore.pri)
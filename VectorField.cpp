@@ -1,6 +1,57 @@
 #include "VectorField.h"
+#include <queue>
+
+// Curl from the gradients of the components: (dK/dy - dJ/dz, dI/dz - dK/dx, dJ/dx - dI/dy)
+static Vec3 CurlOf(const Dual &i, const Dual &j, const Dual &k) {
+  struct Vec3 result;
+  result.x = k.D[1] - j.D[2];
+  result.y = i.D[2] - k.D[0];
+  result.z = j.D[0] - i.D[1];
+  return result;
+}
 
 Vec3 VectorField::Eval(float x, float y, float z) {
+  if (dualCurl) {
+    Dual duals[3];
+    curlSource.EvalDual(x, y, z, duals);
+    return CurlOf(duals[0], duals[1], duals[2]);
+  }
+  float components[3];
+  program.Eval(x, y, z, components);
+  struct Vec3 result = {components[0], components[1], components[2]};
+  return result;
+}
+
+void VectorField::Build(Expr *i, Expr *j, Expr *k) {
+  Interner interner;
+  I = interner.Intern(i);
+  J = interner.Intern(j);
+  K = interner.Intern(k);
+  program = Compile({I, J, K});
+}
+
+// The curl of (i, j, k), differentiated symbolically and simplified.
+static void SymbolicCurl(Expr *i, Expr *j, Expr *k, Expr *curl[3]) {
+  // i = dK/dy - dJ/dz
+  curl[0] = Simplify(new Sub(k->Derivative('y'), j->Derivative('z')));
+
+  // j = dI/dz - dK/dx
+  curl[1] = Simplify(new Sub(i->Derivative('z'), k->Derivative('x')));
+
+  // k = dJ/dx - dI/dy
+  curl[2] = Simplify(new Sub(j->Derivative('x'), i->Derivative('y')));
+}
+
+void VectorField::BuildSymbolic() {
+  if (I) return;
+  ExprArena::Scope scope(arena.get());
+  Expr *curl[3];
+  SymbolicCurl(sources[0], sources[1], sources[2], curl);
+  Build(curl[0], curl[1], curl[2]);
+}
+
+Vec3 VectorField::EvalTree(float x, float y, float z) {
+  BuildSymbolic();
   struct Vec3 result;
   result.x = I->Eval(x, y, z);
   result.y = J->Eval(x, y, z);
@@ -8,6 +59,50 @@ Vec3 VectorField::Eval(float x, float y, float z) {
   return result;
 }
 
+void VectorField::EvalBatch(const float *xs, const float *ys, const float *zs, size_t n, float *is, float *js, float *ks) {
+  if (dualCurl) {
+    vector<Dual> di(n), dj(n), dk(n);
+    Dual *duals[3] = {di.data(), dj.data(), dk.data()};
+    curlSource.EvalDualBatch(xs, ys, zs, n, duals);
+    for (size_t p = 0; p < n; ++p) {
+      Vec3 curl = CurlOf(di[p], dj[p], dk[p]);
+      is[p] = curl.x;
+      js[p] = curl.y;
+      ks[p] = curl.z;
+    }
+    return;
+  }
+  float *results[3] = {is, js, ks};
+  Simd::EvalBatch(program, xs, ys, zs, n, results);
+}
+
+Vec3 VectorField::EvalJacobian(float x, float y, float z, Jacobian &jacobian) {
+  BuildSymbolic();
+  Dual duals[3];
+  program.EvalDual(x, y, z, duals);
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      jacobian.D[i][j] = duals[i].D[j];
+    }
+  }
+  struct Vec3 result = {duals[0].V, duals[1].V, duals[2].V};
+  return result;
+}
+
+Vec3 VectorField::CurlAt(float x, float y, float z) {
+  BuildSymbolic();
+  Dual duals[3];
+  program.EvalDual(x, y, z, duals);
+  return CurlOf(duals[0], duals[1], duals[2]);
+}
+
+float VectorField::DivergenceAt(float x, float y, float z) {
+  BuildSymbolic();
+  Dual duals[3];
+  program.EvalDual(x, y, z, duals);
+  return duals[0].D[0] + duals[1].D[1] + duals[2].D[2];
+}
+
 Vec3 VectorField::End(float x, float y, float z) {
   struct Vec3 result;
   struct Vec3 eval = Eval(x, y, z);
@@ -17,37 +112,216 @@ Vec3 VectorField::End(float x, float y, float z) {
   return result;
 }
 
-void VectorField::MinMaxLengths(float xRange, float yRange, float zRange, float step, float &minLength, float &maxLength) {
+// Coordinates visited by for (c = -range; c <= range; c += step), computed
+// by the same accumulation so that every thread samples the same points.
+static vector<float> Axis(float range, float step) {
+  vector<float> coordinates;
+  for (float c = -range; c <= range; c += step) {
+    coordinates.push_back(c);
+  }
+  return coordinates;
+}
+
+bool VectorField::MinMaxLengths(float xRange, float yRange, float zRange, float step, float &minLength, float &maxLength, size_t numThreads, const atomic<bool> *cancel) {
   minLength = numeric_limits<float>::max();
   maxLength = numeric_limits<float>::min();
 
-  for (float x = -xRange; x <= xRange; x += step) {
-    for (float y = -yRange; y <= yRange; y += step) {
-      for (float z = -zRange; z <= zRange; z += step) {
-        Vec3 start = {x, y, z};
-        Vec3 end = End(start.x, start.y, start.z);
-        Vec3 point = Eval(x, y, z);
-        float len = Vector::Length(point);
-        if (len < minLength) minLength = len;
-        if (len > maxLength) maxLength = len;
+  vector<float> xAxis = Axis(xRange, step);
+  vector<float> yAxis = Axis(yRange, step);
+  vector<float> zAxis = Axis(zRange, step);
+
+  // Each x slice is reduced on its own and the slices are combined at the
+  // end. min and max are exact, so the result does not depend on how the
+  // slices are spread over threads.
+  vector<float> sliceMin(xAxis.size(), minLength);
+  vector<float> sliceMax(xAxis.size(), maxLength);
+
+  atomic<bool> cancelled(false);
+  auto sampleSlice = [&](size_t slice) {
+    if (cancel && cancel->load(memory_order_relaxed)) {
+      cancelled = true;
+      return;
+    }
+    // Points are gathered into chunks and evaluated together.
+    const size_t chunkSize = 4 * Program::BatchSize;
+    vector<float> xs(chunkSize, xAxis[slice]), ys(chunkSize), zs(chunkSize);
+    vector<float> is(chunkSize), js(chunkSize), ks(chunkSize);
+    size_t count = 0;
+    float localMin = sliceMin[slice];
+    float localMax = sliceMax[slice];
+
+    auto flush = [&]() {
+      EvalBatch(xs.data(), ys.data(), zs.data(), count, is.data(), js.data(), ks.data());
+      for (size_t i = 0; i < count; ++i) {
+        float len = Vector::Length({is[i], js[i], ks[i]});
+        if (len < localMin) localMin = len;
+        if (len > localMax) localMax = len;
+      }
+      count = 0;
+    };
+
+    for (float y : yAxis) {
+      for (float z : zAxis) {
+        ys[count] = y;
+        zs[count] = z;
+        if (++count == chunkSize) flush();
       }
     }
+    if (count > 0) flush();
+    sliceMin[slice] = localMin;
+    sliceMax[slice] = localMax;
+  };
+
+  if (numThreads == 1) {
+    for (size_t slice = 0; slice < xAxis.size(); ++slice) {
+      sampleSlice(slice);
+    }
+  } else {
+    ThreadPool::Shared().ParallelFor(xAxis.size(), sampleSlice, numThreads);
   }
+  if (cancelled) {
+    return false;
+  }
+
+  for (size_t slice = 0; slice < xAxis.size(); ++slice) {
+    if (sliceMin[slice] < minLength) minLength = sliceMin[slice];
+    if (sliceMax[slice] > maxLength) maxLength = sliceMax[slice];
+  }
+  return true;
 }
 
-VectorField *VectorField::Curl() {
-  // i = dK/dy - dJ/dz
-  Expr *i = new Sub(K->Derivative('y'), J->Derivative('z'));
+// Smallest and largest vector length over a box, by interval evaluation.
+// Returns false if every value in it is NaN.
+static bool LengthRange(const Program &program, Vec3 lo, Vec3 hi, float &minLength, float &maxLength) {
+  Interval components[3];
+  program.EvalInterval({lo.x, hi.x}, {lo.y, hi.y}, {lo.z, hi.z}, components);
+  double minSquared = 0, maxSquared = 0;
+  for (const Interval &c : components) {
+    if (c.IsEmpty()) return false;
+    double l = (double)c.Lo * c.Lo, h = (double)c.Hi * c.Hi;
+    maxSquared += fmax(l, h);
+    // A component whose range includes 0 may vanish.
+    if (c.Lo > 0 || c.Hi < 0) minSquared += fmin(l, h);
+  }
+  minLength = fmaxf(nextafterf((float)sqrt(minSquared), 0), 0);
+  maxLength = nextafterf((float)sqrt(maxSquared), INFINITY);
+  return true;
+}
 
-  // j = dK/dx - dI/dz
-  Expr *j = new Sub(K->Derivative('x'), I->Derivative('z'));
+struct LengthBox {
+  Vec3 Lo;
+  Vec3 Hi;
+  // Bound on sign * length within the box.
+  float Bound;
 
-  // k = dJ/dx - dI/dy
-  Expr *k = new Sub(J->Derivative('x'), I->Derivative('y'));
-  return new VectorField(i->Simplify(), j->Simplify(), k->Simplify());
+  bool operator<(const LengthBox &other) const {
+    return Bound < other.Bound;
+  }
+};
+
+// One half of BoundLengths: finds the largest length for sign 1, or the
+// smallest for sign -1, working on sign * length throughout. found is the
+// best length reached at a box center and bound the one no length passes.
+static bool SearchLength(VectorField &field, const Program &program, Vec3 range, float sign, float scale, const LengthSearch &search, const atomic<bool> *cancel,
+                         float &found, float &bound, bool &converged, size_t &evaluations) {
+  priority_queue<LengthBox> boxes;
+  float best = -INFINITY;
+  auto push = [&](Vec3 lo, Vec3 hi) {
+    float minLength, maxLength;
+    ++evaluations;
+    if (!LengthRange(program, lo, hi, minLength, maxLength)) return;
+    float boxBound = sign > 0 ? maxLength : -minLength;
+    if (boxBound > best) boxes.push({lo, hi, boxBound});
+  };
+  push({-range.x, -range.y, -range.z}, range);
+
+  converged = false;
+  for (size_t split = 0; split < search.MaxBoxes && !boxes.empty(); ++split) {
+    if (cancel && cancel->load(memory_order_relaxed)) {
+      return false;
+    }
+    LengthBox box = boxes.top();
+    float tolerance = search.Tolerance * fmaxf(fmaxf(scale, fabsf(best)), 0.000001f);
+    if (best > -INFINITY && box.Bound - best <= tolerance) {
+      converged = true;
+      break;
+    }
+    boxes.pop();
+
+    Vec3 center = {0.5f * (box.Lo.x + box.Hi.x), 0.5f * (box.Lo.y + box.Hi.y), 0.5f * (box.Lo.z + box.Hi.z)};
+    float length = Vector::Length(field.Eval(center.x, center.y, center.z));
+    ++evaluations;
+    if (sign * length > best) best = sign * length;
+
+    // Halves along the widest side.
+    Vec3 size = Vector::GetVector(box.Lo, box.Hi);
+    Vec3 lowerHi = box.Hi, upperLo = box.Lo;
+    if (size.x >= size.y && size.x >= size.z) {
+      lowerHi.x = upperLo.x = center.x;
+    } else if (size.y >= size.z) {
+      lowerHi.y = upperLo.y = center.y;
+    } else {
+      lowerHi.z = upperLo.z = center.z;
+    }
+    push(box.Lo, lowerHi);
+    push(upperLo, box.Hi);
+  }
+  if (boxes.empty()) {
+    converged = true;
+  }
+
+  // No length anywhere is past the best box left or the best one found.
+  float signedBound = boxes.empty() ? best : fmaxf(best, boxes.top().Bound);
+  found = sign * best;
+  bound = sign * signedBound;
+  return true;
+}
+
+bool VectorField::BoundLengths(float xRange, float yRange, float zRange, LengthBounds &bounds, const LengthSearch &search, const atomic<bool> *cancel) {
+  Vec3 range = {xRange, yRange, zRange};
+  bounds.Evaluations = 0;
+  if (dualCurl) {
+    // There is no interval form of the dual curl, and the symbolic one may
+    // differ from it where Div clamps.
+    bounds = {0, INFINITY, false, 0};
+    return true;
+  }
+  float maxFound, minFound;
+  bool maxConverged, minConverged;
+  // The largest length sets the scale of the tolerance for the smallest.
+  if (!SearchLength(*this, program, range, 1, 0, search, cancel, maxFound, bounds.Max, maxConverged, bounds.Evaluations) ||
+      !SearchLength(*this, program, range, -1, maxFound, search, cancel, minFound, bounds.Min, minConverged, bounds.Evaluations)) {
+    return false;
+  }
+  bounds.Converged = maxConverged && minConverged && isfinite(bounds.Min) && isfinite(bounds.Max);
+  return true;
+}
+
+VectorField *VectorField::Curl(CurlMode mode) {
+  BuildSymbolic();
+  if (mode == CurlMode::DualNumbers) {
+    // Only the program of this field is needed to evaluate the curl.
+    VectorField *curl = new VectorField(arena);
+    curl->dualCurl = true;
+    curl->curlSource = program;
+    curl->sources[0] = I;
+    curl->sources[1] = J;
+    curl->sources[2] = K;
+    return curl;
+  }
+  ExprArena::Scope scope(arena.get());
+  Expr *curl[3];
+  SymbolicCurl(I, J, K, curl);
+  return new VectorField(curl[0], curl[1], curl[2], arena);
+}
+
+size_t VectorField::NumNodes() {
+  BuildSymbolic();
+  return CountNodes({I, J, K});
 }
 
 string VectorField::ToString() {
+  BuildSymbolic();
   string i = StringUtils::Bold("i") + " = " + I->ToString();
   string j = StringUtils::Bold("j") + " = " + J->ToString();
   string k = StringUtils::Bold("k") + " = " + K->ToString();
@@ -1,27 +1,128 @@
 #ifndef VECTORFIELD_VECTORFIELD
 #define VECTORFIELD_VECTORFIELD
 #include "Expr.h"
+#include "Bytecode.h"
+#include "Intern.h"
+#include "Simplifier.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
 #include "Utils/MathUtils.h"
 #include "Utils/StringUtils.h"
 #include <vector>
 #include <limits>
 #include <string>
+#include <memory>
+#include <atomic>
 
 using namespace Expression;
 using namespace std;
 
+// Partial derivatives of a field at a point: D[i][j] is the derivative of
+// component i (i, j, k) with respect to coordinate j (x, y, z).
+struct Jacobian {
+  float D[3][3];
+};
+
+// Limits of VectorField::BoundLengths.
+struct LengthSearch {
+  // The search stops once each bound is within Tolerance times the largest
+  // length found of a length that is actually reached.
+  float Tolerance = 0.01f;
+  // Boxes split by each of the two searches before giving up.
+  size_t MaxBoxes = 20000;
+};
+
+struct LengthBounds {
+  // Every vector length in the range lies in [Min, Max], NaN aside.
+  float Min;
+  float Max;
+  // Whether both bounds got within the tolerance. If not, they still hold
+  // but may be far from the actual extremes (or infinite).
+  bool Converged;
+  // Interval and point evaluations made.
+  size_t Evaluations;
+};
+
+enum CurlMode {
+  // Differentiate I, J and K symbolically and evaluate the compiled result.
+  Symbolic,
+  // Evaluate the original field with dual numbers and take the curl of its
+  // Jacobian, at a cost proportional to the size of the original field.
+  // Nothing is differentiated symbolically unless the curl's expressions
+  // are asked for.
+  DualNumbers
+};
+
 class VectorField {
 private:
+  // Null on curls created with CurlMode::DualNumbers until something needs
+  // them; see BuildSymbolic.
   Expr *I;
   Expr *J;
   Expr *K;
 
+  // Arena holding the nodes of I, J and K, shared with fields derived from
+  // this one (e.g. its curl). Null if the nodes live in the default arena.
+  shared_ptr<ExprArena> arena;
+
+  // I, J and K lowered to bytecode; the three outputs are the components.
+  Program program;
+
+  // Set on curls created with CurlMode::DualNumbers: the field is then
+  // evaluated as the curl of curlSource, the program of the original field,
+  // whose components are sources.
+  bool dualCurl = false;
+  Program curlSource;
+  Expr *sources[3] = {nullptr, nullptr, nullptr};
+
+  // An empty field, for Curl to fill in.
+  VectorField(shared_ptr<ExprArena> arena) : I(nullptr), J(nullptr), K(nullptr), arena(arena) {}
+  // Interns i, j and k into I, J and K and compiles them into program.
+  void Build(Expr *i, Expr *j, Expr *k);
+  // Builds I, J, K and program of a dual curl from sources, the first time
+  // they are needed (by ToString, EvalTree, the Jacobian or a further curl).
+  // Not safe to race with other calls on the same field.
+  void BuildSymbolic();
+
 public:
-  VectorField(Expr *i, Expr *j, Expr *k) : I(i), J(j), K(k) {}
+  // Identical subexpressions of i, j and k are merged into shared nodes
+  // before compiling, so each is evaluated once per point. The merging
+  // rewrites child pointers of i, j and k in place (see Interner): the
+  // trees passed in then share nodes, but evaluate exactly as before.
+  VectorField(Expr *i, Expr *j, Expr *k, shared_ptr<ExprArena> arena = nullptr) : arena(arena) {
+    Build(i, j, k);
+  }
   Vec3 Eval(float x, float y, float z);
+  // Evaluates by walking the Expr trees. Slower than Eval, which runs the
+  // compiled program; kept for comparison and debugging.
+  Vec3 EvalTree(float x, float y, float z);
+  // Evaluates the field at n points given as separate coordinate arrays and
+  // writes each component to its own array of n floats. Uses the SIMD backend
+  // selected by Simd::ActiveIsa().
+  void EvalBatch(const float *xs, const float *ys, const float *zs, size_t n, float *is, float *js, float *ks);
+  // Evaluates the field and its Jacobian at a point in a single pass.
+  Vec3 EvalJacobian(float x, float y, float z, Jacobian &jacobian);
+  Vec3 CurlAt(float x, float y, float z);
+  float DivergenceAt(float x, float y, float z);
   Vec3 End(float x, float y, float z);
-  void MinMaxLengths(float xRange, float yRange, float zRange, float step, float &minLength, float &maxLength);
-  VectorField *Curl();
+  // Smallest and largest vector length on the grid of points spaced step
+  // apart within [-range, range] on each axis. Samples are spread over up to
+  // numThreads threads of the shared pool (all of them for 0, the calling
+  // thread only for 1); the result is the same for any thread count.
+  // Returns false, leaving the lengths undefined, if cancel was set before
+  // every sample was taken.
+  bool MinMaxLengths(float xRange, float yRange, float zRange, float step, float &minLength, float &maxLength, size_t numThreads = 0, const atomic<bool> *cancel = nullptr);
+  // Bounds of the vector length over the whole box [-range, range], not just
+  // a grid in it. Branch and bound: boxes are split where interval
+  // evaluation of the field leaves the most room for a larger (or smaller)
+  // length than the largest (or smallest) one found at box centers, and
+  // dropped once they cannot hold one. Returns false, leaving bounds
+  // undefined, if cancel was set first. Curls made with
+  // CurlMode::DualNumbers are not supported and never converge.
+  bool BoundLengths(float xRange, float yRange, float zRange, LengthBounds &bounds, const LengthSearch &search = LengthSearch(), const atomic<bool> *cancel = nullptr);
+  VectorField *Curl(CurlMode mode = CurlMode::Symbolic);
+  // Number of distinct Expr nodes in I, J and K.
+  size_t NumNodes();
   string ToString();
 };
 
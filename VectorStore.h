@@ -0,0 +1,103 @@
+#ifndef VECTORFIELD_VECTORSTORE
+#define VECTORFIELD_VECTORSTORE
+#include "Utils/MathUtils.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct GraphicsVector {
+  struct Vec3 start;
+  struct Vec3 end;
+  Color color;
+  string crossA;
+  string crossB;
+  float dotProduct;
+};
+
+// The vectors of the vector view, one array per property so that drawing
+// and bounding them only reads what it needs. Vectors are never removed,
+// only flagged as deleted, so indices stay valid.
+class VectorStore {
+public:
+  // Per-vector state, as bits of Flags.
+  enum Flag : uint8_t {
+    // Neither the vector nor its dots are drawn, and it does not count
+    // towards the bounding box.
+    Hidden = 1 << 0,
+    // A unit-length copy is drawn from its start.
+    Normalized = 1 << 1,
+    // A copy is drawn from the origin.
+    FromOrigin = 1 << 2,
+    Deleted = 1 << 3
+  };
+
+  size_t Size() const { return starts.size(); }
+
+  size_t Add(Vec3 start, Vec3 end, Color color, string crossA = "", string crossB = "", float dot = 0.0f) {
+    starts.push_back(start);
+    ends.push_back(end);
+    colors.push_back(color);
+    flags.push_back(0);
+    crossAs.push_back(crossA);
+    crossBs.push_back(crossB);
+    dotProducts.push_back(crossA != "" && crossB != "" ? dot : 0.0f);
+    if (crossA == "" && crossB == "") ++numUncrossed;
+    return Size() - 1;
+  }
+
+  void Clear() {
+    starts.clear();
+    ends.clear();
+    colors.clear();
+    flags.clear();
+    crossAs.clear();
+    crossBs.clear();
+    dotProducts.clear();
+    numDeleted = 0;
+    numUncrossed = 0;
+  }
+
+  const vector<Vec3> &Starts() const { return starts; }
+  const vector<Vec3> &Ends() const { return ends; }
+  const vector<Color> &Colors() const { return colors; }
+  const vector<uint8_t> &Flags() const { return flags; }
+
+  bool Has(size_t index, Flag flag) const {
+    return flags[index] & flag;
+  }
+
+  void Set(size_t index, Flag flag, bool on) {
+    if (flag == Deleted && Has(index, Deleted) != on) {
+      numDeleted += on ? 1 : -1;
+    }
+    if (on) {
+      flags[index] |= flag;
+    } else {
+      flags[index] &= ~flag;
+    }
+  }
+
+  size_t NumDeleted() const { return numDeleted; }
+  // Vectors added without either cross product name, deleted or not.
+  size_t NumUncrossed() const { return numUncrossed; }
+
+  GraphicsVector At(size_t index) const {
+    return {starts.at(index), ends.at(index), colors.at(index), crossAs.at(index), crossBs.at(index), dotProducts.at(index)};
+  }
+
+private:
+  vector<Vec3> starts;
+  vector<Vec3> ends;
+  vector<Color> colors;
+  vector<uint8_t> flags;
+  // Only read by the vector list, never while drawing.
+  vector<string> crossAs;
+  vector<string> crossBs;
+  vector<float> dotProducts;
+  size_t numDeleted = 0;
+  size_t numUncrossed = 0;
+};
+
+#endif
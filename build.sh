@@ -1,2 +1,2 @@
 echo "+++ Running make... +++"
-make && echo "+++ Done running make - opening Vector Visualizer.app... +++" && open -a "Vector Visualizer"
\ No newline at end of file
+make -f Makefile.VectorCore && make && echo "+++ Done running make - opening Vector Visualizer.app... +++" && open -a "Vector Visualizer"
\ No newline at end of file
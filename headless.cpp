@@ -0,0 +1,248 @@
+#include "headless.h"
+#include "oglwidget.h"
+#include "Jobs.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QTextDocumentFragment>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+// One image to render: a field, a function or a set of vectors.
+struct HeadlessScene {
+  GraphicsMode Mode;
+  // Components of the field or function, or the vectors as start and end.
+  QStringList Components;
+  vector<Vec3> Starts;
+  vector<Vec3> Ends;
+};
+
+bool WantsHeadless(int argc, char *argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--headless")) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PrepareHeadlessPlatform() {
+  // The offscreen platform plugin needs no display server, and Mesa's
+  // software rasterizer no GPU.
+  if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  if (!qEnvironmentVariableIsSet("LIBGL_ALWAYS_SOFTWARE")) {
+    qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+  }
+  QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+}
+
+// Parses count comma-separated numbers.
+static bool ParseNumbers(const QString &text, int count, vector<float> &numbers) {
+  QStringList parts = text.split(',');
+  if (parts.size() != count) {
+    return false;
+  }
+  numbers.clear();
+  for (const QString &part : parts) {
+    bool ok;
+    numbers.push_back(part.trimmed().toFloat(&ok));
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parses the three components of a field or function, separated by ';'.
+static bool ParseComponents(const QString &text, GraphicsMode mode, vector<HeadlessScene> &scenes) {
+  QStringList components = text.split(';');
+  if (components.size() != 3) {
+    return false;
+  }
+  scenes.push_back({mode, components, {}, {}});
+  return true;
+}
+
+// Sets the widget up to show scene. Returns false, with the reason in error,
+// if its expressions could not be parsed.
+static bool ShowScene(OGLWidget &widget, const HeadlessScene &scene, float tMin, float tMax, int numVectors, bool showCurl, string &error) {
+  // Jobs are run right here, so nothing ever cancels them.
+  atomic<bool> cancel(false);
+  widget.SetMode(scene.Mode);
+  if (scene.Mode == GraphicsMode::Field) {
+    FieldJob job;
+    job.IText = scene.Components[0].toStdString();
+    job.JText = scene.Components[1].toStdString();
+    job.KText = scene.Components[2].toStdString();
+    job.Range = widget.VectorFieldRange();
+    job.Step = widget.VectorFieldStep();
+    job.Run(cancel);
+    if (!job.Errors.empty()) {
+      error = job.Errors;
+      return false;
+    }
+    widget.SetVectorField(job.Field, job.Curl, job.MinFieldLength, job.MaxFieldLength, job.MinCurlLength, job.MaxCurlLength);
+    job.Field = nullptr;
+    job.Curl = nullptr;
+    widget.SetViewField(true);
+    widget.SetViewCurl(showCurl);
+  } else if (scene.Mode == GraphicsMode::Function) {
+    FunctionJob job;
+    job.XText = scene.Components[0].toStdString();
+    job.YText = scene.Components[1].toStdString();
+    job.ZText = scene.Components[2].toStdString();
+    job.TMin = tMin;
+    job.TMax = tMax;
+    job.NumVectors = 2 * numVectors;
+    job.Run(cancel);
+    if (!job.Errors.empty()) {
+      error = job.Errors;
+      return false;
+    }
+    if (job.RangeError) {
+      error = "maximum t value must be greater than minimum t value";
+      return false;
+    }
+    widget.SetFunctions(job.X, job.Y, job.Z, job.TMin, job.TMax, job.Samples, job.Arena);
+  } else {
+    for (size_t i = 0; i < scene.Starts.size(); ++i) {
+      widget.AddVector(scene.Starts[i], scene.Ends[i]);
+    }
+  }
+  return true;
+}
+
+int RunHeadless(const QStringList &arguments) {
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Renders vectors, functions and vector fields into images without a window.");
+  parser.addHelpOption();
+  QCommandLineOption headlessOption("headless", "Render without a window instead of starting the application.");
+  QCommandLineOption fieldOption("field", "Vector field to render, as i;j;k. May be given several times.", "i;j;k");
+  QCommandLineOption fieldsOption("fields", "File of vector fields to render, one i;j;k per line.", "file");
+  QCommandLineOption functionOption("function", "Vector-valued function of t to render, as x;y;z.", "x;y;z");
+  QCommandLineOption tMinOption("tmin", "Smallest t of the function.", "t", "0");
+  QCommandLineOption tMaxOption("tmax", "Largest t of the function.", "t", "10");
+  QCommandLineOption numVectorsOption("vectors", "Arrows along the function.", "count", "10");
+  QCommandLineOption vectorOption("vector", "Vector to render, as x0,y0,z0,x1,y1,z1. May be given several times; all are drawn together.", "start,end");
+  QCommandLineOption cameraOption("camera", "Camera position, as x,y,z.", "x,y,z");
+  QCommandLineOption noCurlOption("no-curl", "Leave out the curl of vector fields.");
+  QCommandLineOption adaptiveOption("adaptive", "Sample vector fields adaptively.");
+  QCommandLineOption sizeOption("size", "Image size.", "widthxheight", "1000x700");
+  QCommandLineOption outputOption("output", "Image file to write. With several scenes, %1 is replaced by the scene number.", "file");
+  QCommandLineOption repeatOption("repeat", "Render each scene this many times and print the time per frame.", "count", "1");
+  parser.addOptions({headlessOption, fieldOption, fieldsOption, functionOption, tMinOption, tMaxOption, numVectorsOption, vectorOption,
+                     cameraOption, noCurlOption, adaptiveOption, sizeOption, outputOption, repeatOption});
+  parser.process(arguments);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+  auto fail = [&](const QString &message) {
+    err << message << "\n";
+    return 1;
+  };
+
+  vector<HeadlessScene> scenes;
+  for (const QString &field : parser.values(fieldOption)) {
+    if (!ParseComponents(field, GraphicsMode::Field, scenes)) {
+      return fail("--field takes i;j;k, not " + field);
+    }
+  }
+  if (parser.isSet(fieldsOption)) {
+    QFile file(parser.value(fieldsOption));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      return fail("could not open " + file.fileName());
+    }
+    QTextStream lines(&file);
+    while (!lines.atEnd()) {
+      QString line = lines.readLine().trimmed();
+      if (line.isEmpty()) continue;
+      if (!ParseComponents(line, GraphicsMode::Field, scenes)) {
+        return fail("fields are given as i;j;k, not " + line);
+      }
+    }
+  }
+  if (parser.isSet(functionOption) && !ParseComponents(parser.value(functionOption), GraphicsMode::Function, scenes)) {
+    return fail("--function takes x;y;z, not " + parser.value(functionOption));
+  }
+  if (parser.isSet(vectorOption)) {
+    HeadlessScene scene = {GraphicsMode::Vectors, {}, {}, {}};
+    for (const QString &text : parser.values(vectorOption)) {
+      vector<float> n;
+      if (!ParseNumbers(text, 6, n)) {
+        return fail("--vector takes x0,y0,z0,x1,y1,z1, not " + text);
+      }
+      scene.Starts.push_back({n[0], n[1], n[2]});
+      scene.Ends.push_back({n[3], n[4], n[5]});
+    }
+    scenes.push_back(scene);
+  }
+  if (scenes.empty()) {
+    return fail("nothing to render: give --field, --fields, --function or --vector");
+  }
+
+  vector<float> camera;
+  if (parser.isSet(cameraOption) && !ParseNumbers(parser.value(cameraOption), 3, camera)) {
+    return fail("--camera takes x,y,z, not " + parser.value(cameraOption));
+  }
+  QStringList size = parser.value(sizeOption).split('x');
+  bool widthOk = false, heightOk = false;
+  int width = size.size() == 2 ? size[0].toInt(&widthOk) : 0;
+  int height = size.size() == 2 ? size[1].toInt(&heightOk) : 0;
+  if (!widthOk || !heightOk || width <= 0 || height <= 0) {
+    return fail("--size takes widthxheight, not " + parser.value(sizeOption));
+  }
+  QString output = parser.value(outputOption);
+  if (output.isEmpty()) {
+    output = scenes.size() > 1 ? "frame-%1.png" : "frame.png";
+  } else if (scenes.size() > 1 && !output.contains("%1")) {
+    return fail("--output needs %1 for the scene number when there are several scenes");
+  }
+  int repeat = max(parser.value(repeatOption).toInt(), 1);
+
+  // One widget renders every scene, so the context is only created once.
+  OGLWidget widget;
+  widget.SetAdaptiveSampling(parser.isSet(adaptiveOption));
+  int failures = 0;
+  for (size_t n = 0; n < scenes.size(); ++n) {
+    string error;
+    if (!ShowScene(widget, scenes[n], parser.value(tMinOption).toFloat(), parser.value(tMaxOption).toFloat(),
+                   parser.value(numVectorsOption).toInt(), !parser.isSet(noCurlOption), error)) {
+      // Errors are written as HTML for the application's labels.
+      err << "scene " << n + 1 << ": " << QTextDocumentFragment::fromHtml(QString::fromStdString(error)).toPlainText().trimmed() << "\n";
+      ++failures;
+      continue;
+    }
+    if (!camera.empty()) {
+      widget.SetCameraPosition(camera[0], camera[1], camera[2]);
+    }
+
+    QImage image;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < repeat; ++i) {
+      image = widget.RenderOffscreen(width, height);
+    }
+    qint64 nanoseconds = timer.nsecsElapsed();
+    if (image.isNull()) {
+      return fail("could not create an OpenGL context; set QT_QPA_PLATFORM to a platform with offscreen GL");
+    }
+    if (repeat > 1) {
+      out << "scene " << n + 1 << ": " << nanoseconds / 1e6 / repeat << " ms per frame\n";
+    }
+
+    QString path = scenes.size() > 1 ? output.arg((int)n + 1, 4, 10, QChar('0')) : output;
+    if (!image.save(path)) {
+      err << "could not write " << path << "\n";
+      ++failures;
+    }
+  }
+  return failures ? 1 : 0;
+}
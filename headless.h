@@ -0,0 +1,18 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <QStringList>
+
+// Whether the command line asks for a headless run (--headless).
+bool WantsHeadless(int argc, char *argv[]);
+
+// Chooses a platform and GL that need neither a display server nor a GPU,
+// unless the environment already names them. Must be called before the
+// application object is created.
+void PrepareHeadlessPlatform();
+
+// Renders the scenes given on the command line into image files without
+// showing a window. Returns the exit code of the application.
+int RunHeadless(const QStringList &arguments);
+
+#endif // HEADLESS_H
@@ -1,12 +1,21 @@
 #include <QtWidgets>
 #include "mainwidget.h"
+#include "headless.h"
 
 const int WIDTH = 1000;
 const int HEIGHT = 700;
 
 int main(int argc, char *argv[]) {
+    // With --headless, scenes from the command line are rendered to image
+    // files and no window is ever shown (see headless.h)
+    bool headless = WantsHeadless(argc, argv);
+    if (headless)
+        PrepareHeadlessPlatform();
+
     // Creates an instance of QApplication
     QApplication a(argc, argv);
+    if (headless)
+        return RunHeadless(a.arguments());
 
     a.setStyleSheet("QLineEdit { padding: 2px; } ");
 
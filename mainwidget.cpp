@@ -2,10 +2,13 @@
 #include "mainwidget.h"
 #include "Expr.h"
 #include "Parsing/Parser.h"
-#include "Utils/StringUtils.h"
+#include "Utils/QStringUtils.h"
 #include "Utils/MathUtils.h"
 #include "Parsing/Lexer.h"
 #include "Parsing/ParserAlt.h"
+#include "Parsing/PrecedenceParser.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
 #include <string>
 
 using namespace Expression;
@@ -17,6 +20,9 @@ bool DebugField = false;
 
 // Constructor for main window
 MainWidget::MainWidget(QWidget *parent) : QWidget(parent) {
+  jobReceiver = make_shared<JobReceiver>();
+  jobReceiver->Widget = this;
+
   textBrowser = new QTextBrowser();
   oglWidget = new OGLWidget();
   oglWidget->SetDebug(textBrowser);
@@ -69,6 +75,15 @@ MainWidget::MainWidget(QWidget *parent) : QWidget(parent) {
 
 // Destructor
 MainWidget::~MainWidget() {
+  // Running jobs finish on their own, but no longer report back.
+  functionJobs.Cancel();
+  fieldJobs.Cancel();
+  streamlineJobs.Cancel();
+  {
+    lock_guard<mutex> guard(jobReceiver->Lock);
+    jobReceiver->Widget = nullptr;
+  }
+
   // delete textBrowser;
   // delete funcDebug;
   // delete vectorFieldOutput;
@@ -139,6 +154,17 @@ void MainWidget::CreateMenuBar() {
   minimizeAction->setShortcut(minimize);
 
   menuBar->addMenu(windowMenu);
+
+  QMenu *profileMenu = new QMenu("Profile");
+
+  QAction *showProfileAction = profileMenu->addAction("Show Frame Stats");
+  showProfileAction->setCheckable(true);
+  connect(showProfileAction, SIGNAL(toggled(bool)), this, SLOT(toggleProfile(bool)));
+
+  QAction *exportTraceAction = profileMenu->addAction("Export Trace...");
+  connect(exportTraceAction, SIGNAL(triggered()), this, SLOT(exportTrace()));
+
+  menuBar->addMenu(profileMenu);
 }
 
 QWidget *MainWidget::GetVectorControls() {
@@ -400,6 +426,8 @@ QWidget *MainWidget::GetVectorFieldControls() {
   cameraControls->addWidget(orbitCameraCheckboxVectorField);
   QPushButton *resetCameraButton = new QPushButton("Reset camera");
   cameraControls->addWidget(resetCameraButton);
+  adaptiveSampling = new QCheckBox("Adaptive sampling");
+  cameraControls->addWidget(adaptiveSampling);
   cameraControls->addStretch();
   vectorFieldLayout->addLayout(cameraControls);
 
@@ -441,6 +469,24 @@ QWidget *MainWidget::GetVectorFieldControls() {
   vectorFieldLayout->addWidget(curlMessage);
   vectorFieldLayout->addWidget(curlLenMessage);
 
+  // Spacing between curl and streamlines
+  vectorFieldLayout->addSpacing(25);
+
+  // Streamline controls
+  streamlineView = new QCheckBox("View streamlines");
+  integratorCombo = new QComboBox;
+  integratorCombo->addItem("RK4");
+  integratorCombo->addItem("Dormand-Prince");
+  QHBoxLayout *streamlineLayout = new QHBoxLayout;
+  streamlineLayout->setContentsMargins(0, 0, 0, 0);
+  streamlineLayout->addWidget(streamlineView);
+  streamlineLayout->addWidget(integratorCombo);
+  streamlineLayout->addStretch();
+  streamlineControls = new QWidget;
+  streamlineControls->setLayout(streamlineLayout);
+  streamlineControls->setVisible(false);
+  vectorFieldLayout->addWidget(streamlineControls);
+
   // TODO: for debugging only
   if (DebugField)
     vectorFieldLayout->addWidget(vectorFieldOutput);
@@ -451,6 +497,9 @@ QWidget *MainWidget::GetVectorFieldControls() {
   connect(resetCameraButton, SIGNAL(released()), this, SLOT(onResetCameraVectorField()));
   connect(fieldView, SIGNAL(stateChanged(int)), this, SLOT(onChangeFieldVisibility(int)));
   connect(curlView, SIGNAL(stateChanged(int)), this, SLOT(onChangeCurlVisibility(int)));
+  connect(adaptiveSampling, SIGNAL(stateChanged(int)), this, SLOT(onChangeAdaptiveSampling(int)));
+  connect(streamlineView, SIGNAL(stateChanged(int)), this, SLOT(onChangeStreamlineVisibility(int)));
+  connect(integratorCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(onChangeIntegrator(int)));
 
   // Create a widget with the vector field layout that can be added to a tab widget
   QWidget *vectorFieldWidget = new QWidget;
@@ -628,6 +677,22 @@ void MainWidget::toggleMinimized() {
   }
 }
 
+void MainWidget::toggleProfile(bool show) {
+  oglWidget->SetShowProfile(show);
+}
+
+// Saves what the profiler recorded while frame stats were shown, for
+// chrome://tracing or Perfetto
+void MainWidget::exportTrace() {
+  QString path = QFileDialog::getSaveFileName(this, "Export Trace", "trace.json", "Trace (*.json)");
+  if (path.isEmpty()) {
+    return;
+  }
+  if (!Profiler::Shared().WriteChromeTrace(path.toStdString())) {
+    QMessageBox::warning(this, "Export Trace", "Could not write " + path);
+  }
+}
+
 // Handler for changing tab view (Vectors vs Function vs Vector Field)
 void MainWidget::onChangeTab(int index) {
   textBrowser->append(Fancy("changed tab to " + to_string(index)));
@@ -701,50 +766,62 @@ void MainWidget::onCrossVectors() {
   ColorVectorWidgets();
 }
 
+template <class Job>
+void MainWidget::RunInBackground(shared_ptr<Job> job, JobSlot &slot, function<void(Job &)> done) {
+  shared_ptr<atomic<bool>> cancel = slot.Start();
+  shared_ptr<JobReceiver> receiver = jobReceiver;
+  ThreadPool::Shared().Submit([job, cancel, receiver, done]() {
+    if (!job->Run(*cancel)) {
+      return;
+    }
+    lock_guard<mutex> guard(receiver->Lock);
+    if (!receiver->Widget) {
+      return;
+    }
+    QMetaObject::invokeMethod(receiver->Widget, [job, cancel, done]() {
+      // A newer job may have started while this one was finishing.
+      if (!*cancel) {
+        done(*job);
+      }
+    }, Qt::QueuedConnection);
+  });
+}
+
 // Handler for button click to create a function
 void MainWidget::onCreateFunction() {
   funcError->setVisible(false);
   funcDebug->clear();
   funcDebug->append(Fancy("Attempting to create function"));
 
-  string errorMsg = "";
-
-  ParserAlt *parser = new ParserAlt(LexMode::SingleVariable, funcDebug);
-
-  string xText = xEdit->text().toStdString();
-  Expr *xFunc = parser->Parse(xText);
-  if (!xFunc) {
-    errorMsg += "Failed to parse function for " + Italic("x") + ".<br/>";
-  }
-
-  string yText = yEdit->text().toStdString();
-  Expr *yFunc = parser->Parse(yText);
-  if (!yFunc) {
-    errorMsg += "Failed to parse function for " + Italic("y") + ".<br/>";
-  }
+  // Parsing and sampling run on a worker thread; ShowFunction picks up the
+  // result.
+  shared_ptr<FunctionJob> job = make_shared<FunctionJob>();
+  job->XText = xEdit->text().toStdString();
+  job->YText = yEdit->text().toStdString();
+  job->ZText = zEdit->text().toStdString();
+  job->TMin = tMinSpin->value();
+  job->TMax = tMaxSpin->value();
+  job->NumVectors = 2 * numVectorsSlider->value();
+  job->Debug = DebugFunction;
+  RunInBackground<FunctionJob>(job, functionJobs, [this](FunctionJob &done) { ShowFunction(done); });
+}
 
-  string zText = zEdit->text().toStdString();
-  Expr *zFunc = parser->Parse(zText);
-  if (!zFunc) {
-    errorMsg += "Failed to parse function for " + Italic("z") + ".<br/>";
+void MainWidget::ShowFunction(FunctionJob &job) {
+  for (const string &message : job.Log.Messages) {
+    funcDebug->append(Fancy(message));
   }
 
-  if (xFunc && yFunc && zFunc) {
-    float min = tMinSpin->value();
-    float max = tMaxSpin->value();
-    if (max - min < 0.005) {
-      funcError->setText(Fancy("Error: maximum " + Italic("t") + " value must be greater than minimum " + Italic("t") + " value."));
-      funcError->setVisible(true);
-      tMinSpin->setFocus(Qt::OtherFocusReason);
-      return;
-    }
-    int numVectors = 2 * numVectorsSlider->value();
-    oglWidget->SetFunctions(xFunc, yFunc, zFunc, min, max, numVectors);
-  } else {
-    funcError->setText(Fancy(errorMsg));
+  if (!job.Errors.empty()) {
+    funcError->setText(Fancy(job.Errors));
     funcError->setVisible(true);
     funcDebug->append(Fancy("Failed to parse functions"));
     xEdit->setFocus(Qt::OtherFocusReason);
+  } else if (job.RangeError) {
+    funcError->setText(Fancy("Error: maximum " + Italic("t") + " value must be greater than minimum " + Italic("t") + " value."));
+    funcError->setVisible(true);
+    tMinSpin->setFocus(Qt::OtherFocusReason);
+  } else {
+    oglWidget->SetFunctions(job.X, job.Y, job.Z, job.TMin, job.TMax, job.Samples, job.Arena);
   }
 }
 
@@ -753,68 +830,72 @@ void MainWidget::onCreateVectorField() {
   vectorFieldOutput->clear();
   textBrowser->clear();
   fieldError->setVisible(false);
-  string errorMsg = "";
 
-  // ParserAlt *parser = new ParserAlt(LexMode::MultiVariable, vectorFieldOutput); // Output debug info to separate text browser
-  ParserAlt *parser = new ParserAlt(LexMode::MultiVariable); // No debugging
+  // Parsing, the curl and the length extremes are computed on a worker
+  // thread; ShowVectorField picks up the result.
+  shared_ptr<FieldJob> job = make_shared<FieldJob>();
+  job->IText = iEdit->text().toStdString();
+  job->JText = jEdit->text().toStdString();
+  job->KText = kEdit->text().toStdString();
+  job->Range = oglWidget->VectorFieldRange();
+  job->Step = oglWidget->VectorFieldStep();
+  job->Debug = DebugField; // Output debug info to separate text browser
+  vectorFieldOutput->append("Creating vector field");
+  RunInBackground<FieldJob>(job, fieldJobs, [this](FieldJob &done) { ShowVectorField(done); });
+}
 
-  std::string iText = iEdit->text().toStdString();
-  Expr *iFunc = parser->Parse(iText);
-  if (!iFunc) {
-    errorMsg += "Failed to parse function for " + Italic("i") + ".<br/>";
+void MainWidget::ShowVectorField(FieldJob &job) {
+  for (const string &message : job.Log.Messages) {
+    vectorFieldOutput->append(Fancy(message));
   }
 
-  std::string jText = jEdit->text().toStdString();
-  Expr *jFunc = parser->Parse(jText);
-  if (!jFunc) {
-    errorMsg += "Failed to parse function for " + Italic("j") + ".<br/>";
+  if (!job.Errors.empty()) {
+    fieldError->setText(Fancy(job.Errors));
+    fieldError->setVisible(true);
+    iEdit->setFocus(Qt::OtherFocusReason);
+    return;
   }
 
-  std::string kText = kEdit->text().toStdString();
-  Expr *kFunc = parser->Parse(kText);
-  if (!kFunc) {
-    errorMsg += "Failed to parse function for " + Italic("k") + ".<br/>";
+  compileButton->setText("Update vector field");
+  VectorField *field = job.Field;
+  VectorField *curl = job.Curl;
+  job.Field = nullptr;
+  job.Curl = nullptr;
+  vectorFieldOutput->append("Created vector field");
+  oglWidget->SetVectorField(field, curl, job.MinFieldLength, job.MaxFieldLength, job.MinCurlLength, job.MaxCurlLength);
+  float minLength = oglWidget->MinVectorFieldLength(), maxLength = oglWidget->MaxVectorFieldLength();
+
+  fieldDivider->setVisible(true);
+  fieldColor->setVisible(true);
+  fieldView->setVisible(true);
+  fieldView->setChecked(true);
+  fieldMessage->setVisible(true);
+  string fieldMsg = Bold("Vector field: ") + Equation("v") + "<br/>" + field->ToString();
+  fieldMessage->setText(Fancy(fieldMsg));
+  string message = "Minimum vector length of " + Bold("v") + " = " + TrimZeroes(minLength) +
+                   "<br/>Maximum vector length of " + Bold("v") + " = " + TrimZeroes(maxLength);
+  minMaxMessage->setVisible(true);
+  minMaxMessage->setWordWrap(true);
+  minMaxMessage->setText(Fancy(message));
+
+  if (curl) {
+    curlColor->setVisible(true);
+    curlView->setVisible(true);
+    curlView->setChecked(true);
+    curlMessage->setVisible(true);
+    string curlMsg = Bold("Curl(v): ") + Equation("c") + "<br/>" + curl->ToString();
+    curlMessage->setText(Fancy(curlMsg));
+    float min = oglWidget->MinCurlLength(), max = oglWidget->MaxCurlLength();
+    string lenMsg = "Minimum vector length of " + Bold("curl(v)") + " = " + TrimZeroes(min) +
+                    "<br/>Maximum vector length of " + Bold("curl(v)") + " = " + TrimZeroes(max);
+    curlLenMessage->setVisible(true);
+    curlLenMessage->setWordWrap(true);
+    curlLenMessage->setText(Fancy(lenMsg));
   }
 
-  if (iFunc && jFunc && kFunc) {
-    compileButton->setText("Update vector field");
-    VectorField *field = new VectorField(iFunc, jFunc, kFunc);
-    vectorFieldOutput->append("Created vector field");
-    oglWidget->SetVectorField(field);
-    float minLength = oglWidget->MinVectorFieldLength(), maxLength = oglWidget->MaxVectorFieldLength();
-
-    fieldDivider->setVisible(true);
-    fieldColor->setVisible(true);
-    fieldView->setVisible(true);
-    fieldView->setChecked(true);
-    fieldMessage->setVisible(true);
-    string fieldMsg = Bold("Vector field: ") + Equation("v") + "<br/>" + field->ToString();
-    fieldMessage->setText(Fancy(fieldMsg));
-    string message = "Minimum vector length of " + Bold("v") + " = " + TrimZeroes(minLength) +
-                     "<br/>Maximum vector length of " + Bold("v") + " = " + TrimZeroes(maxLength);
-    minMaxMessage->setVisible(true);
-    minMaxMessage->setWordWrap(true);
-    minMaxMessage->setText(Fancy(message));
-
-    VectorField *curl = oglWidget->Curl();
-    if (curl) {
-      curlColor->setVisible(true);
-      curlView->setVisible(true);
-      curlView->setChecked(true);
-      curlMessage->setVisible(true);
-      string curlMsg = Bold("Curl(v): ") + Equation("c") + "<br/>" + curl->ToString();
-      curlMessage->setText(Fancy(curlMsg));
-      float min = oglWidget->MinCurlLength(), max = oglWidget->MaxCurlLength();
-      string lenMsg = "Minimum vector length of " + Bold("curl(v)") + " = " + TrimZeroes(min) +
-                      "<br/>Maximum vector length of " + Bold("curl(v)") + " = " + TrimZeroes(max);
-      curlLenMessage->setVisible(true);
-      curlLenMessage->setWordWrap(true);
-      curlLenMessage->setText(Fancy(lenMsg));
-    }
-  } else {
-    fieldError->setText(Fancy(errorMsg));
-    fieldError->setVisible(true);
-    iEdit->setFocus(Qt::OtherFocusReason);
+  streamlineControls->setVisible(true);
+  if (streamlineView->isChecked()) {
+    UpdateStreamlines();
   }
 }
 
@@ -909,3 +990,46 @@ void MainWidget::onChangeFieldVisibility(int state) {
 void MainWidget::onChangeCurlVisibility(int state) {
   oglWidget->SetViewCurl(state);
 }
+
+void MainWidget::onChangeAdaptiveSampling(int state) {
+  oglWidget->SetAdaptiveSampling(state);
+}
+
+void MainWidget::onChangeStreamlineVisibility(int state) {
+  oglWidget->SetViewStreamlines(state);
+  if (state) {
+    UpdateStreamlines();
+  } else {
+    streamlineJobs.Cancel();
+  }
+}
+
+void MainWidget::onChangeIntegrator(int) {
+  if (streamlineView->isChecked()) {
+    UpdateStreamlines();
+  }
+}
+
+void MainWidget::UpdateStreamlines() {
+  VectorField *field = oglWidget->CurrentVectorField();
+  if (!field) {
+    return;
+  }
+  // Lengths are relative to the size of the range, so that lines look
+  // alike however large it is.
+  Vec3 range = oglWidget->VectorFieldRange();
+  float size = Vector::Length(range);
+  shared_ptr<StreamlineJob> job = make_shared<StreamlineJob>();
+  job->Field = new VectorField(*field);
+  job->Range = range;
+  job->Options.Method = integratorCombo->currentIndex() == 0 ? Integrator::RK4 : Integrator::DormandPrince;
+  job->Options.Bounds = range;
+  job->Options.Step = size / 200;
+  job->Options.MinStep = size / 20000;
+  job->Options.MaxStep = size / 20;
+  job->Options.Tolerance = size / 20000;
+  job->Options.MaxLength = 2 * size;
+  RunInBackground<StreamlineJob>(job, streamlineJobs, [this](StreamlineJob &done) {
+    oglWidget->SetStreamlines(done.Lines);
+  });
+}
@@ -10,7 +10,11 @@
 #include <QEvent>
 #include <QDoubleSpinBox>
 #include "oglwidget.h"
+#include "Jobs.h"
 #include <vector>
+#include <mutex>
+#include <memory>
+#include <functional>
 
 using namespace std;
 
@@ -38,8 +42,19 @@ private:
   QWidget *SolidWidget(Color color, int width, int height);
   QIcon SolidIcon(Color color, int width, int height);
 
+  // Runs job on the shared thread pool and then done on the GUI thread,
+  // unless the job was cancelled or superseded by a newer one in slot.
+  template <class Job>
+  void RunInBackground(shared_ptr<Job> job, JobSlot &slot, function<void(Job &)> done);
+  void ShowFunction(FunctionJob &job);
+  void ShowVectorField(FieldJob &job);
+  // Traces streamlines of the field shown with the selected integrator.
+  void UpdateStreamlines();
+
 private slots:
   void toggleMinimized();
+  void toggleProfile(bool show);
+  void exportTrace();
   void onChangeTab(int index);
   void onAddVector();
   void onCrossVectors();
@@ -58,6 +73,9 @@ private slots:
   void onDeleteVector(size_t index);
   void onChangeFieldVisibility(int state);
   void onChangeCurlVisibility(int state);
+  void onChangeStreamlineVisibility(int state);
+  void onChangeAdaptiveSampling(int state);
+  void onChangeIntegrator(int index);
 
 private:
   // Controls for debugging
@@ -114,6 +132,21 @@ private:
   QCheckBox *curlView;
   QLabel *curlMessage;
   QLabel *curlLenMessage;
+  QCheckBox *adaptiveSampling;
+  QWidget *streamlineControls;
+  QCheckBox *streamlineView;
+  QComboBox *integratorCombo;
+
+  // Background jobs. Starting one cancels the previous job of its kind.
+  JobSlot functionJobs;
+  JobSlot fieldJobs;
+  JobSlot streamlineJobs;
+  // Lets workers post results only while this widget exists.
+  struct JobReceiver {
+    mutex Lock;
+    MainWidget *Widget;
+  };
+  shared_ptr<JobReceiver> jobReceiver;
 };
 
 #endif // MAINWIDGET_H
\ No newline at end of file
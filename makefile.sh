@@ -1,3 +1,5 @@
+echo "Generating Makefile.VectorCore from VectorCore.pro..."
+qmake VectorCore.pro
 echo "Generating Makefile from Vector Visualizer.pro..."
 qmake "Vector Visualizer.pro"
 echo "Done generating Makefile from Vector Visualizer.pro."
\ No newline at end of file
@@ -18,6 +18,13 @@ OGLWidget::OGLWidget(QWidget *parent) : QOpenGLWidget(parent), time(0.5f) {
   time = 0.0f;
   mode = GraphicsMode::Vectors;
 
+  // Repaint only when RequestFrame asks for it, instead of on a fixed
+  // interval. Resizes and exposes repaint through QOpenGLWidget itself.
+  frameTimer = new QTimer(this);
+  frameTimer->setSingleShot(true);
+  connect(frameTimer, SIGNAL(timeout()), this, SLOT(update()));
+  clock.start();
+
   // Initialize rendering properties.
   backgroundColor = {0, 0.5, 1, 1};
 
@@ -48,12 +55,7 @@ OGLWidget::OGLWidget(QWidget *parent) : QOpenGLWidget(parent), time(0.5f) {
   rangevf_Z = "5";
   rangeVF = {stof(rangevf_X), stof(rangevf_Y), stof(rangevf_Z)};
   vectorField = nullptr;
-
-  // Run the QWidget::update function on an interval.
-  // This ensures that paintGL is run on an interval so the graphics actually update.
-  QTimer *timer = new QTimer(this);
-  connect(timer, SIGNAL(timeout()), this, SLOT(update()));
-  timer->start(10);
+  curl = nullptr;
 
   setMouseTracking(true);
 }
@@ -63,19 +65,34 @@ OGLWidget::~OGLWidget() {
 
   gluDeleteQuadric(quadric);
 
-  vectors.clear();
-  disabledVectors.clear();
-  normalizedVectors.clear();
-  deletedVectors.clear();
+  vectors.Clear();
 
-  // delete xFunc;
-  // delete yFunc;
-  // delete zFunc;
+  // The function nodes are freed along with funcArena.
   funcPoints.clear();
-  arrowPoints.clear();
+  funcArrowIndices.clear();
+
+  delete vectorField;
+  delete curl;
 
-  // delete vectorField;
-  // delete curl;
+  // Vertex buffers can only be freed in their context.
+  if (offscreenContext) {
+    offscreenContext->makeCurrent(offscreenSurface);
+    delete offscreenTarget;
+  } else {
+    makeCurrent();
+  }
+  arrowRenderer.Destroy();
+  fieldArrows.Destroy();
+  curlArrows.Destroy();
+  coordinateSystem.Destroy();
+  funcCurve.Destroy();
+  funcArrows.Destroy();
+  streamlines.Destroy();
+  if (offscreenContext) {
+    offscreenContext->doneCurrent();
+  } else {
+    doneCurrent();
+  }
 }
 
 void OGLWidget::mousePressEvent(QMouseEvent * event) {
@@ -118,15 +135,51 @@ void OGLWidget::wheelEvent(QWheelEvent *event) {
 void OGLWidget::initializeGL() {
   // Set the background color
   glClearColor(backgroundColor.r, backgroundColor.g, backgroundColor.b, backgroundColor.a);
+  SetGLState();
+
+  arrowRenderer.Initialize();
+}
+
+void OGLWidget::SetGLState() {
   glEnable(GL_DEPTH_TEST);
   glEnable(GL_LIGHT0);
   glEnable(GL_LIGHTING);
   glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
   glEnable(GL_COLOR_MATERIAL);
+  // Arrow cones are scaled per arrow, which scales their normals too.
+  glEnable(GL_NORMALIZE);
+}
+
+void OGLWidget::RequestFrame() {
+  if (frameTimer->isActive()) {
+    return;
+  }
+  // Waits out the rest of the frame interval since the last frame.
+  qint64 frameInterval = 1000 / maxFramesPerSecond;
+  qint64 sinceLastFrame = lastFrameTime < 0 ? frameInterval : clock.elapsed() - lastFrameTime;
+  frameTimer->start(max<qint64>(0, frameInterval - sinceLastFrame));
+}
+
+bool OGLWidget::IsAnimating() {
+  if (orbitCamera) {
+    return true;
+  }
+  // The function is still being revealed.
+  return mode == GraphicsMode::Function && xFunc && yFunc && zFunc && currTMaxIndex / 2 + 1 < (int)funcArrowIndices.size();
 }
 
 void OGLWidget::paintGL() {
-  time += 0.025f;
+  ProfileScope frame("paintGL");
+  // Animations advance by the seconds since the last frame. The first frame
+  // after an idle period steps by at most maxFrameSeconds.
+  const float maxFrameSeconds = 0.05f;
+  qint64 now = clock.elapsed();
+  float frameSeconds = lastFrameTime < 0 ? 0 : MathUtils::Clamp((now - lastFrameTime) / 1000.0f, 0, maxFrameSeconds);
+  lastFrameTime = now;
+  // The camera turns at the rate it used to at 100 frames a second.
+  float cameraStep = 2.5f * frameSeconds;
+
+  time += cameraStep;
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glClearColor(backgroundColor.r, backgroundColor.g, backgroundColor.b, backgroundColor.a);
 
@@ -136,51 +189,133 @@ void OGLWidget::paintGL() {
     if (orbitCamera) {
       // SetCameraPosition(1.5 * cos(0.2 * (cameraTime)), 0.75 * sin(0.2 * cameraTime) + 1.5, 5.3);
       SetCameraPosition(1.2 * sin(0.2 * (cameraTime)), 1.2 * cos(0.2 * cameraTime), 5);
-      cameraTime += 0.025f;
+      cameraTime += cameraStep;
     }
     UpdateCameraVF();
 
-    CoordinateSystem();
+    DrawCoordinateSystem();
     Vectors();
   } else if (mode == GraphicsMode::Function) {
     // Render vector-valued function
     if (orbitCamera) {
       SetCameraPosition(1.2 * sin(0.2 * cameraTime), 1.2 * cos(0.2 * cameraTime), 5);
-      cameraTime += 0.025f;
+      cameraTime += cameraStep;
     }
     UpdateCameraVF();
 
-    CoordinateSystemFunc();
+    DrawCoordinateSystem();
     if (xFunc && yFunc && zFunc) {
-      if (funcTime % 15 == 0) {
-        currTMaxIndex += 2;
-      }
+      // Two more points every funcRevealSeconds.
+      currTMaxIndex = 2 * ((int)(funcTime / funcRevealSeconds) + 1);
       Function(xFunc, yFunc, zFunc, currTMaxIndex);
-      funcTime += 1;
+      funcTime += frameSeconds;
     }
   } else {
     // Render vector field
     if (orbitCamera) {
       SetCameraPosition(sin(0.2 * cameraTime), cos(0.2 * cameraTime), 5);
-      cameraTime += 0.025f;
+      cameraTime += cameraStep;
     }
     UpdateCameraVF();
 
-    CoordinateSystemVF();
+    DrawCoordinateSystem();
+    ProfileScope profile("Field");
     if (viewField) {
-      Color A = {0.0, 0.1, 0.8, 1.0};
-      Color B = {0.0, 0.7, 1.0, 1.0};
-      Field(vectorField, A, B, minVectorFieldLength, maxVectorFieldLength);
+      fieldArrows.Draw(2.0);
     }
     if (viewCurl) {
-      Color C = {0.8, 0.0, 0.0, 1.0};
-      Color D = {1.0, 0.65, 0.0, 1.0};
-      Field(curl, C, D, minCurlLength, maxCurlLength);
+      curlArrows.Draw(2.0);
+    }
+    if (viewStreamlines) {
+      streamlines.Draw();
     }
   }
+
+  if (IsAnimating()) {
+    RequestFrame();
+  }
+
+  // Counters are taken every frame, so each frame's are recorded.
+  int64_t drawCalls = Profiler::Shared().TakeCounter(ProfileCounter::DrawCalls);
+  int64_t arrows = Profiler::Shared().TakeCounter(ProfileCounter::Arrows);
+  // Offscreen renders have a context of their own and show no stats.
+  if (showProfile && QOpenGLContext::currentContext() == context()) {
+    DrawProfileOverlay(QString("%1 ms, %2 draw calls, %3 arrows").arg(frame.Elapsed() / 1000.0, 0, 'f', 2).arg(drawCalls).arg(arrows));
+  }
+}
+
+void OGLWidget::DrawProfileOverlay(const QString &text) {
+  const int margin = 8;
+  const int padding = 4;
+  {
+    QPainter painter(this);
+    QRect textRect = painter.fontMetrics().boundingRect(text);
+    QRect box(margin, margin, textRect.width() + 2 * padding, textRect.height() + 2 * padding);
+    painter.fillRect(box, QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    painter.drawText(box, Qt::AlignCenter, text);
+  }
+  SetGLState();
+}
+
+QImage OGLWidget::RenderOffscreen(int width, int height) {
+  if (!offscreenContext) {
+    offscreenContext = new QOpenGLContext(this);
+    offscreenContext->setFormat(format());
+    offscreenSurface = new QOffscreenSurface(nullptr, this);
+    if (!offscreenContext->create()) {
+      return QImage();
+    }
+    offscreenSurface->setFormat(offscreenContext->format());
+    offscreenSurface->create();
+    if (!offscreenContext->makeCurrent(offscreenSurface)) {
+      return QImage();
+    }
+    initializeGL();
+  } else if (!offscreenContext->makeCurrent(offscreenSurface)) {
+    return QImage();
+  }
+
+  QSize size(width, height);
+  if (!offscreenTarget || offscreenTarget->size() != size) {
+    delete offscreenTarget;
+    offscreenTarget = new QOpenGLFramebufferObject(size, QOpenGLFramebufferObject::CombinedDepthStencil);
+  }
+  offscreenTarget->bind();
+  resizeGL(width, height);
+
+  lastFrameTime = -1;
+  funcTime = funcRevealSeconds * funcArrowIndices.size();
+  paintGL();
+  // paintGL asks for the next frame of whatever it animates.
+  frameTimer->stop();
+
+  QImage image = offscreenTarget->toImage();
+  offscreenTarget->release();
+  offscreenContext->doneCurrent();
+  return image;
+}
+
+// Draws the axes, grid and range markers of the current mode, which are
+// rebuilt only after something they show has changed.
+void OGLWidget::DrawCoordinateSystem() {
+  ProfileScope profile("DrawCoordinateSystem");
+  if (coordinateSystemDirty) {
+    coordinateSystem.Clear();
+    if (mode == GraphicsMode::Vectors) {
+      CoordinateSystem();
+    } else if (mode == GraphicsMode::Function) {
+      CoordinateSystemFunc();
+    } else {
+      CoordinateSystemVF();
+    }
+    coordinateSystemDirty = false;
+  }
+  coordinateSystem.Draw();
 }
 
 void OGLWidget::CoordinateSystem() {
+  ProfileScope profile("CoordinateSystem");
   float min = -3.5;
   float max = 3.0;
   float zRange = 5.0;
@@ -190,61 +325,62 @@ void OGLWidget::CoordinateSystem() {
   float lineHalfSize = 0.07f * coordSystemGridSize;
 
   // x-axis
-  Line({min, 0, 0}, {max, 0, 0}, axis, thickness);
+  coordinateSystem.Add({min, 0, 0}, {max, 0, 0}, axis, thickness);
   // y-axis
-  Line({0, min, 0}, {0, max, 0}, axis, thickness);
+  coordinateSystem.Add({0, min, 0}, {0, max, 0}, axis, thickness);
   // z-axis
-  Line({0, 0, -zRange}, {0, 0, zRange}, axis, thickness);
+  coordinateSystem.Add({0, 0, -zRange}, {0, 0, zRange}, axis, thickness);
 
   // Lines along the x-axis
   for (float x = min; x <= max; x += coordSystemGridSize) {
-    Line({x, -lineHalfSize, 0}, {x, lineHalfSize, 0}, axis, thickness);
+    coordinateSystem.Add({x, -lineHalfSize, 0}, {x, lineHalfSize, 0}, axis, thickness);
   }
   // Lines along the y-axis
   for (float y = min; y <= max; y += coordSystemGridSize) {
-    Line({-lineHalfSize, y, 0}, {lineHalfSize, y, 0}, axis, thickness);
+    coordinateSystem.Add({-lineHalfSize, y, 0}, {lineHalfSize, y, 0}, axis, thickness);
   }
   // Lines along the z-axis
   float zGridSize = coordSystemZ/(coordSystemLimit/coordSystemGridSize);
   for (float z = 0; z <= zRange; z += zGridSize) {
-    Line({-lineHalfSize, 0, z}, {lineHalfSize, 0, z}, axis, thickness);
+    coordinateSystem.Add({-lineHalfSize, 0, z}, {lineHalfSize, 0, z}, axis, thickness);
   }
   for (float z = -zGridSize; z >= -zRange; z -= zGridSize) {
-    Line({-lineHalfSize, 0, z}, {lineHalfSize, 0, z}, axis, thickness);
+    coordinateSystem.Add({-lineHalfSize, 0, z}, {lineHalfSize, 0, z}, axis, thickness);
   }
 
   // Vertical gray lines in the xy-plane
   for (float x = min; x <= max; x += coordSystemGridSize) {
-    Line({x, min, 0}, {x, max, 0}, grid, thickness);
+    coordinateSystem.Add({x, min, 0}, {x, max, 0}, grid, thickness);
   }
   // Horizontal gray lines in the xy-plane
   for (float y = min; y <= max; y += coordSystemGridSize) {
-    Line({min, y, 0}, {max, y, 0}, grid, thickness);
+    coordinateSystem.Add({min, y, 0}, {max, y, 0}, grid, thickness);
   }
 
   // X range markers
   string xMin = Precision(box.min.x, 2);
   string xMax = Precision(box.max.x, 2);
-  NumberGraphic::DrawAxis('x', 1.92, -0.1, 0.01);
-  NumberGraphic::DrawNumber(xMin, -1.97, 0.03, 0.01, NumberGraphic::Direction::LToR);
-  NumberGraphic::DrawNumber(xMax, 2.0, 0.03, 0.01, NumberGraphic::Direction::RToL);
+  NumberGraphic::AppendAxis(coordinateSystem, 'x', 1.92, -0.1, 0.01);
+  NumberGraphic::AppendNumber(coordinateSystem, xMin, -1.97, 0.03, 0.01, NumberGraphic::Direction::LToR);
+  NumberGraphic::AppendNumber(coordinateSystem, xMax, 2.0, 0.03, 0.01, NumberGraphic::Direction::RToL);
   // Y range markers
   string yMin = Precision(box.min.y, 2);
   string yMax = Precision(box.max.y, 2);
-  NumberGraphic::DrawAxis('y', -0.07, 1.9, 0.01);
-  NumberGraphic::DrawNumber(yMin, 0.02, -1.97, 0.01, NumberGraphic::Direction::LToR);
-  NumberGraphic::DrawNumber(yMax, 0.02, 1.9, 0.01, NumberGraphic::Direction::LToR);
+  NumberGraphic::AppendAxis(coordinateSystem, 'y', -0.07, 1.9, 0.01);
+  NumberGraphic::AppendNumber(coordinateSystem, yMin, 0.02, -1.97, 0.01, NumberGraphic::Direction::LToR);
+  NumberGraphic::AppendNumber(coordinateSystem, yMax, 0.02, 1.9, 0.01, NumberGraphic::Direction::LToR);
   // Z range markers
   if (showZMarkers) {
     string zMin = Precision(box.min.z, 2);
     string zMax = Precision(box.max.z, 2);
-    NumberGraphic::DrawAxis('z', -0.1, 0.0, coordSystemZ);
-    NumberGraphic::DrawNumber(zMin, 0.04, 0.0, -coordSystemZ, NumberGraphic::Direction::LToR);
-    NumberGraphic::DrawNumber(zMax, 0.04, 0.0, coordSystemZ, NumberGraphic::Direction::LToR);
+    NumberGraphic::AppendAxis(coordinateSystem, 'z', -0.1, 0.0, coordSystemZ);
+    NumberGraphic::AppendNumber(coordinateSystem, zMin, 0.04, 0.0, -coordSystemZ, NumberGraphic::Direction::LToR);
+    NumberGraphic::AppendNumber(coordinateSystem, zMax, 0.04, 0.0, coordSystemZ, NumberGraphic::Direction::LToR);
   }
 }
 
 void OGLWidget::CoordinateSystemFunc() {
+  ProfileScope profile("CoordinateSystemFunc");
   float min = -2.5;
   float max = 2.5;
   float zRange = 5.0;
@@ -254,61 +390,62 @@ void OGLWidget::CoordinateSystemFunc() {
   float lineHalfSize = 0.07f * coordSystemGridSize;
 
   // x-axis
-  Line({min, 0, 0}, {max, 0, 0}, axis, thickness);
+  coordinateSystem.Add({min, 0, 0}, {max, 0, 0}, axis, thickness);
   // y-axis
-  Line({0, min, 0}, {0, max, 0}, axis, thickness);
+  coordinateSystem.Add({0, min, 0}, {0, max, 0}, axis, thickness);
   // z-axis
-  Line({0, 0, -5}, {0, 0, 5}, axis, thickness);
+  coordinateSystem.Add({0, 0, -5}, {0, 0, 5}, axis, thickness);
 
   // Lines along the x-axis
   for (float x = min; x <= max; x += coordSystemGridSize) {
-    Line({x, -lineHalfSize, 0}, {x, lineHalfSize, 0}, axis, thickness);
+    coordinateSystem.Add({x, -lineHalfSize, 0}, {x, lineHalfSize, 0}, axis, thickness);
   }
   // Lines along the y-axis
   for (float y = min; y <= max; y += coordSystemGridSize) {
-    Line({-lineHalfSize, y, 0}, {lineHalfSize, y, 0}, axis, thickness);
+    coordinateSystem.Add({-lineHalfSize, y, 0}, {lineHalfSize, y, 0}, axis, thickness);
   }
   // Lines along the z-axis
   float zGridSize = coordSystemZ/(coordSystemLimit/coordSystemGridSize);
   for (float z = 0; z <= zRange; z += zGridSize) {
-    Line({-lineHalfSize, 0, z}, {lineHalfSize, 0, z}, axis, thickness);
+    coordinateSystem.Add({-lineHalfSize, 0, z}, {lineHalfSize, 0, z}, axis, thickness);
   }
   for (float z = -zGridSize; z >= -zRange; z -= zGridSize) {
-    Line({-lineHalfSize, 0, z}, {lineHalfSize, 0, z}, axis, thickness);
+    coordinateSystem.Add({-lineHalfSize, 0, z}, {lineHalfSize, 0, z}, axis, thickness);
   }
 
   // Vertical gray lines in the xy-plane
   for (float x = min; x <= max; x += coordSystemGridSize) {
-    Line({x, min, 0}, {x, max, 0}, grid, thickness);
+    coordinateSystem.Add({x, min, 0}, {x, max, 0}, grid, thickness);
   }
   // Horizontal gray lines in the xy-plane
   for (float y = min; y <= max; y += coordSystemGridSize) {
-    Line({min, y, 0}, {max, y, 0}, grid, thickness);
+    coordinateSystem.Add({min, y, 0}, {max, y, 0}, grid, thickness);
   }
 
   // X range markers
   string xMin = Precision(funcBox.min.x, 2);
   string xMax = Precision(funcBox.max.x, 2);
-  NumberGraphic::DrawAxis('x', 1.92, -0.1, 0.01);
-  NumberGraphic::DrawNumber(xMin, -1.97, 0.03, 0.01, NumberGraphic::Direction::LToR);
-  NumberGraphic::DrawNumber(xMax, 2.0, 0.03, 0.01, NumberGraphic::Direction::RToL);
+  NumberGraphic::AppendAxis(coordinateSystem, 'x', 1.92, -0.1, 0.01);
+  NumberGraphic::AppendNumber(coordinateSystem, xMin, -1.97, 0.03, 0.01, NumberGraphic::Direction::LToR);
+  NumberGraphic::AppendNumber(coordinateSystem, xMax, 2.0, 0.03, 0.01, NumberGraphic::Direction::RToL);
   // Y range markers
   string yMin = Precision(funcBox.min.y, 2);
   string yMax = Precision(funcBox.max.y, 2);
-  NumberGraphic::DrawAxis('y', -0.07, 1.9, 0.01);
-  NumberGraphic::DrawNumber(yMin, 0.02, -1.97, 0.01, NumberGraphic::Direction::LToR);
-  NumberGraphic::DrawNumber(yMax, 0.02, 1.9, 0.01, NumberGraphic::Direction::LToR);
+  NumberGraphic::AppendAxis(coordinateSystem, 'y', -0.07, 1.9, 0.01);
+  NumberGraphic::AppendNumber(coordinateSystem, yMin, 0.02, -1.97, 0.01, NumberGraphic::Direction::LToR);
+  NumberGraphic::AppendNumber(coordinateSystem, yMax, 0.02, 1.9, 0.01, NumberGraphic::Direction::LToR);
   // Z range markers
   if (showZFuncMarkers) {
     string zMin = Precision(funcBox.min.z, 2);
     string zMax = Precision(funcBox.max.z, 2);
-    NumberGraphic::DrawAxis('z', -0.1, 0.0, coordSystemZ);
-    NumberGraphic::DrawNumber(zMin, 0.04, 0.0, -coordSystemZ, NumberGraphic::Direction::LToR);
-    NumberGraphic::DrawNumber(zMax, 0.04, 0.0, coordSystemZ, NumberGraphic::Direction::LToR);
+    NumberGraphic::AppendAxis(coordinateSystem, 'z', -0.1, 0.0, coordSystemZ);
+    NumberGraphic::AppendNumber(coordinateSystem, zMin, 0.04, 0.0, -coordSystemZ, NumberGraphic::Direction::LToR);
+    NumberGraphic::AppendNumber(coordinateSystem, zMax, 0.04, 0.0, coordSystemZ, NumberGraphic::Direction::LToR);
   }
 }
 
 void OGLWidget::CoordinateSystemVF() {
+  ProfileScope profile("CoordinateSystemVF");
   float min = -2.5;
   float max = 2.5;
   Color axis = {0, 0, 0, 1};
@@ -316,63 +453,61 @@ void OGLWidget::CoordinateSystemVF() {
   float thickness = 3.0;
 
   // x-axis
-  Line({min, 0, 0}, {max, 0, 0}, axis, thickness);
+  coordinateSystem.Add({min, 0, 0}, {max, 0, 0}, axis, thickness);
   // y-axis
-  Line({0, min, 0}, {0, max, 0}, axis, thickness);
+  coordinateSystem.Add({0, min, 0}, {0, max, 0}, axis, thickness);
   // z-axis
-  Line({0, 0, -5}, {0, 0, 5}, axis, thickness);
-
-  // Vertical lines along the x-axis
-  for (float x = min; x <= max; x += coordSystemGridSize) {
-    Line({x, min, 0}, {x, max, 0}, grid, thickness);
-  }
-  // Horizontal lines along the y-axis
-  for (float y = min; y <= max; y += coordSystemGridSize) {
-    Line({min, y, 0}, {max, y, 0}, grid, thickness);
-  }
+  coordinateSystem.Add({0, 0, -5}, {0, 0, 5}, axis, thickness);
 
   // Vertical gray lines in the xy-plane
   for (float x = min; x <= max; x += coordSystemGridSize) {
-    Line({x, min, 0}, {x, max, 0}, grid, thickness);
+    coordinateSystem.Add({x, min, 0}, {x, max, 0}, grid, thickness);
   }
   // Horizontal gray lines in the xy-plane
   for (float y = min; y <= max; y += coordSystemGridSize) {
-    Line({min, y, 0}, {max, y, 0}, grid, thickness);
+    coordinateSystem.Add({min, y, 0}, {max, y, 0}, grid, thickness);
   }
 
   // X range markers
-  NumberGraphic::DrawAxis('x', 1.92, -0.1, 0.01);
-  NumberGraphic::DrawNumber("-" + rangevf_X, -1.97, 0.03, 0.01, NumberGraphic::Direction::LToR);
-  NumberGraphic::DrawNumber(rangevf_X, 2.0, 0.03, 0.01, NumberGraphic::Direction::RToL);
+  NumberGraphic::AppendAxis(coordinateSystem, 'x', 1.92, -0.1, 0.01);
+  NumberGraphic::AppendNumber(coordinateSystem, "-" + rangevf_X, -1.97, 0.03, 0.01, NumberGraphic::Direction::LToR);
+  NumberGraphic::AppendNumber(coordinateSystem, rangevf_X, 2.0, 0.03, 0.01, NumberGraphic::Direction::RToL);
   // Y range markers
-  NumberGraphic::DrawAxis('y', -0.07, 1.9, 0.01);
-  NumberGraphic::DrawNumber("-" + rangevf_Y, 0.02, -1.97, 0.01, NumberGraphic::Direction::LToR);
-  NumberGraphic::DrawNumber(rangevf_Y, 0.02, 1.9, 0.01, NumberGraphic::Direction::LToR);
+  NumberGraphic::AppendAxis(coordinateSystem, 'y', -0.07, 1.9, 0.01);
+  NumberGraphic::AppendNumber(coordinateSystem, "-" + rangevf_Y, 0.02, -1.97, 0.01, NumberGraphic::Direction::LToR);
+  NumberGraphic::AppendNumber(coordinateSystem, rangevf_Y, 0.02, 1.9, 0.01, NumberGraphic::Direction::LToR);
 }
 
 void OGLWidget::Vectors() {
+  ProfileScope profile("Vectors");
   Vec2 fromX = {box.min.x, box.max.x};
   Vec2 fromY = {box.min.y, box.max.y};
   Vec2 fromZ = {box.min.z, box.max.z};
   Vec2 toXY = {-coordSystemLimit, coordSystemLimit};
   Vec2 toZ = {-coordSystemZ, coordSystemZ};
-  for (size_t i = 0; i < vectors.size(); ++i) {
+  const vector<Vec3> &starts = vectors.Starts();
+  const vector<Vec3> &ends = vectors.Ends();
+  const vector<Color> &colors = vectors.Colors();
+  const vector<uint8_t> &flags = vectors.Flags();
+  for (size_t i = 0; i < vectors.Size(); ++i) {
     // Do not render deleted vectors
-    if (deletedVectors.find(i) != deletedVectors.end()) {
+    if (flags[i] & VectorStore::Deleted) {
       continue;
     }
 
-    GraphicsVector v = vectors.at(i);
+    const Vec3 &vStart = starts[i];
+    const Vec3 &vEnd = ends[i];
+    const Color &vColor = colors[i];
 
     // Render the actual vector if it is not disabled
-    if (disabledVectors.find(i) == disabledVectors.end()) {
-      float xStart = MathUtils::MapToRange(v.start.x, fromX, toXY);
-      float yStart = MathUtils::MapToRange(v.start.y, fromY, toXY);
-      float zStart = MathUtils::MapToRange(v.start.z, fromZ, toZ);
+    if (!(flags[i] & VectorStore::Hidden)) {
+      float xStart = MathUtils::MapToRange(vStart.x, fromX, toXY);
+      float yStart = MathUtils::MapToRange(vStart.y, fromY, toXY);
+      float zStart = MathUtils::MapToRange(vStart.z, fromZ, toZ);
 
-      float xEnd = MathUtils::MapToRange(v.end.x, fromX, toXY);
-      float yEnd = MathUtils::MapToRange(v.end.y, fromY, toXY);
-      float zEnd = MathUtils::MapToRange(v.end.z, fromZ, toZ);
+      float xEnd = MathUtils::MapToRange(vEnd.x, fromX, toXY);
+      float yEnd = MathUtils::MapToRange(vEnd.y, fromY, toXY);
+      float zEnd = MathUtils::MapToRange(vEnd.z, fromZ, toZ);
 
       Vec3 start = {xStart, yStart, zStart};
       Vec3 end = {xEnd, yEnd, zEnd};
@@ -380,20 +515,18 @@ void OGLWidget::Vectors() {
 
       // VERY IMPORTANT: draw the dots BEFORE drawing the arrow.
       // This prevents the dots from doing weird things to the rest of the colors.
-      Color dotColor = MathUtils::TweenColor(v.color, {0.1, 0.1, 0.1}, 0.5);
+      Color dotColor = MathUtils::TweenColor(vColor, {0.1, 0.1, 0.1}, 0.5);
       Sphere(start, dotColor, 0.03);
       Sphere(end, dotColor, 0.03);
 
-      Arrow(start, end, v.color, 10.0 * len);
+      Arrow(start, end, vColor, 10.0 * len);
     }
 
     // Render the normalized vector if it is set to draw the normalized version
-    auto N = normalizedVectors.find(i);
-    if (N != normalizedVectors.end()) {
-      GraphicsVector n = vectors.at(*N);
-      Vec3 normalized = Vector::Normalize(Vector::GetVector(n.start, n.end));
-      Vec3 nStart = n.start;
-      Vec3 nEnd = {n.start.x + normalized.x, n.start.y + normalized.y, n.start.z + normalized.z};
+    if (flags[i] & VectorStore::Normalized) {
+      Vec3 normalized = Vector::Normalize(Vector::GetVector(vStart, vEnd));
+      Vec3 nStart = vStart;
+      Vec3 nEnd = {vStart.x + normalized.x, vStart.y + normalized.y, vStart.z + normalized.z};
 
       float x1 = MathUtils::MapToRange(nStart.x, fromX, toXY);
       float y1 = MathUtils::MapToRange(nStart.y, fromX, toXY);
@@ -406,15 +539,13 @@ void OGLWidget::Vectors() {
       Vec3 s = {x1, y1, z1};
       Vec3 e = {x2, y2, z2};
       float len = Vector::Length(s, e);
-      Color color = MathUtils::TweenColor(v.color, {0.9, 0.9, 0.9}, 0.4);
+      Color color = MathUtils::TweenColor(vColor, {0.9, 0.9, 0.9}, 0.4);
       Arrow(s, e, color, 8.0 * len);
     }
 
     // Render the vector start at the origin if it is set to draw the origin version
-    auto O = originVectors.find(i);
-    if (O != originVectors.end()) {
-      GraphicsVector o = vectors.at(*O);
-      Vec3 origin = Vector::GetVector(o.start, o.end);
+    if (flags[i] & VectorStore::FromOrigin) {
+      Vec3 origin = Vector::GetVector(vStart, vEnd);
       
       float x2 = MathUtils::MapToRange(origin.x, fromX, toXY);
       float y2 = MathUtils::MapToRange(origin.y, fromY, toXY);
@@ -423,43 +554,35 @@ void OGLWidget::Vectors() {
       Vec3 s = {0, 0, 0};
       Vec3 e = {x2, y2, z2};
       float len = Vector::Length(s, e);
-      Color color = MathUtils::TweenColor(v.color, {0.9, 0.9, 0.9}, 0.5);
+      Color color = MathUtils::TweenColor(vColor, {0.9, 0.9, 0.9}, 0.5);
       Arrow(s, e, color, 8.0 * len);
     }
   }
 }
 
 void OGLWidget::SetBoundingBox() {
-  Debug("Setting bounding box for " + to_string(vectors.size()) + " vectors");
-  vector<float> nums = {coordSystemLimit};
-  for (size_t index = 0; index < vectors.size(); ++index) {
-    if (deletedVectors.find(index) != deletedVectors.end()) {
+  Debug("Setting bounding box for " + to_string(vectors.Size()) + " vectors");
+  // The box is a cube around the origin that holds every shown vector.
+  float extent = coordSystemLimit;
+  const vector<Vec3> &starts = vectors.Starts();
+  const vector<Vec3> &ends = vectors.Ends();
+  const vector<uint8_t> &flags = vectors.Flags();
+  for (size_t index = 0; index < vectors.Size(); ++index) {
+    if (flags[index] & (VectorStore::Deleted | VectorStore::Hidden)) {
       continue;
     }
-    if (disabledVectors.find(index) != disabledVectors.end()) {
-      continue;
+    for (const Vec3 &v : {starts[index], ends[index]}) {
+      extent = fmax(extent, fmax(fabs(v.x), fmax(fabs(v.y), fabs(v.z))));
     }
-    GraphicsVector v = vectors.at(index);
-    nums.push_back(v.start.x);
-    nums.push_back(v.start.y);
-    nums.push_back(v.start.z);
-    nums.push_back(v.end.x);
-    nums.push_back(v.end.y);
-    nums.push_back(v.end.z);
-  }
-
-  float max = MathUtils::Max(nums);
-  float min = MathUtils::Min(nums);
-  max = MathUtils::Max({MathUtils::Abs(max), MathUtils::Abs(min)});
-  max = ceil((max * 4.0))/4.0;
+  }
+
+  float max = ceil((extent * 4.0))/4.0;
   box.min = {-max, -max, -max};
   box.max = {max, max, max};
+  coordinateSystemDirty = true;
 }
 
-void OGLWidget::Function(Expr *xF, Expr *yF, Expr *zF, int tMaxIndex) {
-  if (!xF || !yF || !zF)
-    return;
-
+void OGLWidget::UpdateFunctionGeometry() {
   Vec2 fromX = {funcBox.min.x, funcBox.max.x};
   Vec2 fromY = {funcBox.min.y, funcBox.max.y};
   Vec2 fromZ = {funcBox.min.z, funcBox.max.z};
@@ -474,43 +597,62 @@ void OGLWidget::Function(Expr *xF, Expr *yF, Expr *zF, int tMaxIndex) {
     return result;
   };
 
-  Color funcColor = {0, 0.3, 1, 1};
   Color arrowA = {0, 0.4, 0.5, 1};
   Color arrowB = {0, 0.7, 0.8, 1};
 
-  auto drawArrow = [this, scale, arrowA, arrowB](int index) {
-    auto It = arrowPoints.find(index);
-    if (It != arrowPoints.end()) {
-      Vec3 arrow = scale(It->second);
-      float len = Vector::Length(It->second);
-      float percentLen = 1.0f;
-      if (maxArrLen - minArrLen > 0.0001) {
-        percentLen = (len - minArrLen) / (maxArrLen - minArrLen);
-      }
-      Color c = MathUtils::TweenColor(arrowA, arrowB, percentLen);
-      Arrow({0, 0, 0}, arrow, c, 3.0f, 0.05f);
+  vector<Vec3> curve;
+  curve.reserve(funcPoints.size());
+  for (Vec3 point : funcPoints) {
+    curve.push_back(scale(point));
+  }
+  vector<ArrowShape> shapes;
+  vector<Color> colors;
+  for (int index : funcArrowIndices) {
+    float len = Vector::Length(funcPoints[index]);
+    float percentLen = 1.0f;
+    if (maxArrLen - minArrLen > 0.0001) {
+      percentLen = (len - minArrLen) / (maxArrLen - minArrLen);
     }
-  };
+    shapes.push_back(ArrowGraphic::Shape({0, 0, 0}, curve[index], 0.05f));
+    colors.push_back(MathUtils::TweenColor(arrowA, arrowB, percentLen));
+  }
+  funcCurve.Set(curve);
+  funcArrows.Set(shapes, colors);
+}
 
-  // Draw the arrow to the start point of the function
-  drawArrow(0);
+void OGLWidget::Function(Expr *xF, Expr *yF, Expr *zF, int tMaxIndex) {
+  ProfileScope profile("Function");
+  if (!xF || !yF || !zF)
+    return;
 
-  // Draw line segements and arrows up to tMaxIndex
-  for (int i = 2; i <= tMaxIndex && i <= funcPoints.size() - 1; ++i) {
-    // Draw two line segments that lead up to i (i should have an arrow drawn to it)
-    Vec3 start = scale(funcPoints[i - 2]);
-    Vec3 mid = scale(funcPoints[i - 1]);
-    Vec3 end = scale(funcPoints[i]);
-    Line(start, mid, funcColor, 10.0f);
-    Line(mid, end, funcColor, 10.0f);
-    // Draw the arrow at i
-    drawArrow(i);
+  // The arrows up to tMaxIndex / 2 are revealed, and the curve up to the
+  // last of them.
+  int numArrows = min(tMaxIndex / 2 + 1, (int)funcArrowIndices.size());
+  if (numArrows <= 0) {
+    return;
   }
+  Color funcColor = {0, 0.3, 1, 1};
+  funcCurve.Draw(funcColor, 10.0f, funcArrowIndices[numArrows - 1] + 1);
+  funcArrows.Draw(3.0f, numArrows);
+}
+
+void OGLWidget::UpdateFieldArrows() {
+  Color A = {0.0, 0.1, 0.8, 1.0};
+  Color B = {0.0, 0.7, 1.0, 1.0};
+  SampleField(vectorField, A, B, minVectorFieldLength, maxVectorFieldLength, fieldArrows);
+  Color C = {0.8, 0.0, 0.0, 1.0};
+  Color D = {1.0, 0.65, 0.0, 1.0};
+  SampleField(curl, C, D, minCurlLength, maxCurlLength, curlArrows);
 }
 
-void OGLWidget::Field(VectorField *field, Color A, Color B, float minLength, float maxLength) {
-  if (!field)
+void OGLWidget::SampleField(VectorField *field, Color A, Color B, float minLength, float maxLength, ArrowBatch &arrows) {
+  ProfileScope profile("SampleField");
+  vector<ArrowShape> shapes;
+  vector<Color> colors;
+  if (!field) {
+    arrows.Set(shapes, colors);
     return;
+  }
 
   const float maxRenderedLength = 0.3f;
   const float minRenderedLength = 0.05f;
@@ -535,110 +677,91 @@ void OGLWidget::Field(VectorField *field, Color A, Color B, float minLength, flo
   Debug("mapping to length range " + Precision(toLen.x) + ", " + Precision(toLen.y));
   Debug("range size: " + Precision(MathUtils::Abs(fromLen.y - fromLen.x), 6));
 
-  for (float x = -xRenderedRange; x <= xRenderedRange; x += coordSystemGridSize) {
-    for (float y = -yRenderedRange; y <= yRenderedRange; y += coordSystemGridSize) {
-      for (float z = -zRenderedRange; z <= zRenderedRange; z += zStep) {
-        Vec3 start = {x, y, z};
-
-        float evalX = (x / xRenderedRange) * xRange;
-        float evalY = (y / yRenderedRange) * yRange;
-        float evalZ = (z / zRenderedRange) * zRange;
-        evalX = MathUtils::MapToRange(x, {-xRenderedRange, xRenderedRange}, {-xRange, xRange});
-        evalY = MathUtils::MapToRange(y, {-yRenderedRange, yRenderedRange}, {-yRange, yRange});
-        evalZ = MathUtils::MapToRange(z, {-zRenderedRange, zRenderedRange}, {-zRange, zRange});
-        Vec3 point = field->Eval(evalX, evalY, evalZ);
-        float len = Vector::Length(point);
-        float renderedLength = MathUtils::MapToRange(len, fromLen, toLen);
-        // Debug("len: " + Precision(len, 1) + ", renderedLength: " + Precision(renderedLength));
-        Vec3 normalizedPoint = Vector::SetLength(point, renderedLength);
-        Vec3 end;
-        end.x = x + normalizedPoint.x;
-        end.y = y + normalizedPoint.y;
-        end.z = z + normalizedPoint.z;
-
-        Color renderedColor;
-        renderedColor.r = MathUtils::MapToRange(len, fromLen, toRed);
-        renderedColor.g = MathUtils::MapToRange(len, fromLen, toGreen);
-        renderedColor.b = MathUtils::MapToRange(len, fromLen, toBlue);
-        renderedColor.a = 1;
-        Arrow(start, end, renderedColor, 2.0);
+  vector<Vec3> starts;
+  vector<Vec3> points;
+  // Arrows of refined octree cells are shortened along with the cells.
+  vector<float> sizes;
+  if (adaptiveSampling) {
+    FieldSamples samples;
+    SampleFieldOctree(*field, rangeVF, OctreeSampling(), samples);
+    for (Vec3 p : samples.Points) {
+      starts.push_back({MathUtils::MapToRange(p.x, {-xRange, xRange}, {-xRenderedRange, xRenderedRange}),
+                        MathUtils::MapToRange(p.y, {-yRange, yRange}, {-yRenderedRange, yRenderedRange}),
+                        MathUtils::MapToRange(p.z, {-zRange, zRange}, {-zRenderedRange, zRenderedRange})});
+    }
+    points = samples.Values;
+    sizes = samples.Sizes;
+  } else {
+    // Gather the grid points first so the whole grid is evaluated in one batch.
+    vector<float> evalXs, evalYs, evalZs;
+    for (float x = -xRenderedRange; x <= xRenderedRange; x += coordSystemGridSize) {
+      for (float y = -yRenderedRange; y <= yRenderedRange; y += coordSystemGridSize) {
+        for (float z = -zRenderedRange; z <= zRenderedRange; z += zStep) {
+          starts.push_back({x, y, z});
+          evalXs.push_back(MathUtils::MapToRange(x, {-xRenderedRange, xRenderedRange}, {-xRange, xRange}));
+          evalYs.push_back(MathUtils::MapToRange(y, {-yRenderedRange, yRenderedRange}, {-yRange, yRange}));
+          evalZs.push_back(MathUtils::MapToRange(z, {-zRenderedRange, zRenderedRange}, {-zRange, zRange}));
+        }
       }
     }
-  }
-}
 
-void OGLWidget::Arrow(struct Vec3 start, struct Vec3 end, Color color, float thickness, float maxConeRadius) {
-  // Debug("\nDrawing arrow from start = " + StringUtils::Vec3String(start) + " to end = " + StringUtils::Vec3String(end));
-  // Start drawing.
-  glPushMatrix();
+    size_t n = starts.size();
+    vector<float> is(n), js(n), ks(n);
+    field->EvalBatch(evalXs.data(), evalYs.data(), evalZs.data(), n, is.data(), js.data(), ks.data());
+    for (size_t i = 0; i < n; ++i) {
+      points.push_back({is[i], js[i], ks[i]});
+    }
+    sizes.assign(n, 1.0f);
+  }
 
-  // Dimensions based on vector length.
-  float vecLen = Vector::Length(start, end);
-  float coneLen = MathUtils::Clamp(0.32 * vecLen, 0.05, 0.22);
-  float scaledVecLen = vecLen - coneLen;
-  // Debug("vecLen: " + Precision(vecLen) + ", coneLen: " + Precision(coneLen) + ", " + "scaledVecLen: " + Precision(scaledVecLen));
-  Vec3 scaledVec = Vector::SetLength(Vector::GetVector(start, end), scaledVecLen);
-  Vec3 scaledEnd = {start.x + scaledVec.x, start.y + scaledVec.y, start.z + scaledVec.z};
-  // Debug("scaledEnd = " + StringUtils::Vec3String(scaledEnd));
-  float radius = MathUtils::Clamp(0.32 * coneLen, 0.02, maxConeRadius);
-
-  // Draw the line from start to scaledEnd.
-  Line(start, scaledEnd, color, thickness);
-
-  // Determine the rotation angle and axis to rotate the cone so it is rotated along the line.
-  Vec3 cylinderUp = { 0, 0, 1 };
-  Vec3 vector = Vector::GetVector(start, scaledEnd);
-  Vec3 cross = Vector::Cross(cylinderUp, vector);
-  // It's possible that the cross product could be the zero vector
-  // (e.g. vector, like cylinderUp, lies along the z-axis). If this happens,
-  // adjust the cross vector so that it's a nonzero vector.
-  if (Vector::Length(cross) <= 0.0000001) {
-    cross = cylinderUp;
-  }
-  Vec3 axis = Vector::Normalize(cross);
-  // The angle argument to acos must be in the range [-1, 1].
-  // Normalize the vector to try to keep the dot product small.
-  // If necessary, adjust dot to be in the range [-1, 1].
-  float dot = Vector::Dot(cylinderUp, Vector::Normalize(vector));
-  if (dot < -1) {
-    dot = M_PI;
-  } else if (dot > 1) {
-    dot = 0.0;
-  }
-  float radians = acos(dot);
-  float degrees = radians * 180.0f / M_PI;
-  // Debug("rotating along axis " + StringUtils::Vec3String(axis) + " by " + Precision(degrees) + " degrees");
-
-  // Place the cone at the end of the line and rotate it along the line.
-  glTranslatef(scaledEnd.x, scaledEnd.y, scaledEnd.z);
-  glRotatef(degrees, axis.x, axis.y, axis.z);
-
-  // Draw a cone with a disk at its base to prevent weirdness with the global scene color (it can be dimmed otherwise).
-  GLUquadric *quad = gluNewQuadric();
-  gluCylinder(quad, /*bottomRadius=*/radius, /*topRadius=*/0.0f, /*height=*/coneLen, /*slices=*/32.0, /*stacks=*/32.0);
-  gluDisk(quad, /*innerRadius=*/0.0f, /*outerRadius*/radius, /*slices=*/16, /*loops*/4);
-  gluDeleteQuadric(quad);
-
-  // Stop drawing.
-  glPopMatrix();
+  for (size_t i = 0; i < starts.size(); ++i) {
+    Vec3 start = starts[i];
+    Vec3 point = points[i];
+    float len = Vector::Length(point);
+    float renderedLength = MathUtils::MapToRange(len, fromLen, toLen) * sizes[i];
+    // Debug("len: " + Precision(len, 1) + ", renderedLength: " + Precision(renderedLength));
+    Vec3 normalizedPoint = Vector::SetLength(point, renderedLength);
+    Vec3 end;
+    end.x = start.x + normalizedPoint.x;
+    end.y = start.y + normalizedPoint.y;
+    end.z = start.z + normalizedPoint.z;
+
+    Color renderedColor;
+    renderedColor.r = MathUtils::MapToRange(len, fromLen, toRed);
+    renderedColor.g = MathUtils::MapToRange(len, fromLen, toGreen);
+    renderedColor.b = MathUtils::MapToRange(len, fromLen, toBlue);
+    renderedColor.a = 1;
+    shapes.push_back(ArrowGraphic::Shape(start, end));
+    colors.push_back(renderedColor);
+  }
+  arrows.Set(shapes, colors);
 }
 
-void OGLWidget::Line(struct Vec3 start, struct Vec3 end, Color color, float thickness) {
-  // Start drawing.
-  glPushMatrix();
-
-  // Set color and thickness.
-  glColor4f(color.r, color.g, color.b, color.a);
-  glLineWidth(thickness);
-
-  // Draw the line from start to end.
-  glBegin(GL_LINES);
-    glVertex3f(start.x, start.y, start.z);
-    glVertex3f(end.x, end.y, end.z);
-  glEnd();
+void OGLWidget::SetStreamlines(const Streamlines &lines) {
+  // The same mapping from field to scene coordinates as SampleField.
+  Vec3 scale = {3 * coordSystemGridSize / rangeVF.x, 3 * coordSystemGridSize / rangeVF.y, 1.75f * coordSystemGridSize / rangeVF.z};
+  Color A = {0.1, 0.5, 0.1, 1.0};
+  Color B = {0.6, 1.0, 0.2, 1.0};
+  Vec2 fromLen = {minVectorFieldLength, maxVectorFieldLength};
+
+  vector<Vec3> points(lines.Points.size());
+  vector<Color> colors(lines.Points.size());
+  for (size_t i = 0; i < lines.Points.size(); ++i) {
+    const Vec3 &p = lines.Points[i];
+    points[i] = {p.x * scale.x, p.y * scale.y, p.z * scale.z};
+    float percent = MathUtils::Clamp(MathUtils::MapToRange(lines.Speeds[i], fromLen, {0, 1}), 0, 1);
+    colors[i] = MathUtils::TweenColor(A, B, percent);
+  }
+  streamlines.Clear();
+  for (size_t line = 0; line < lines.NumLines(); ++line) {
+    size_t first = lines.Offsets[line];
+    streamlines.AddStrip(&points[first], &colors[first], lines.Offsets[line + 1] - first, 2.0f);
+  }
+  RequestFrame();
+}
 
-  // Stop drawing.
-  glPopMatrix();
+void OGLWidget::Arrow(struct Vec3 start, struct Vec3 end, Color color, float thickness, float maxConeRadius) {
+  arrowRenderer.Draw(start, end, color, thickness, maxConeRadius);
 }
 
 // This method does weird things to the rest of the colors in the scene
@@ -5,17 +5,31 @@
 #include <QOpenGLWidget>
 #include <QTextBrowser>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QOpenGLFramebufferObject>
+#include <QImage>
+#include <QPainter>
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include "Utils/MathUtils.h"
 #include "VectorField.h"
+#include "VectorStore.h"
 #include "Graphics/Number.h"
+#include "Graphics/Arrows.h"
+#include "Graphics/Lines.h"
 #include "Expr.h"
-#include "Utils/StringUtils.h"
+#include "ExprArena.h"
+#include "Jobs.h"
+#include "FieldSampler.h"
+#include "Profiler.h"
+#include "Utils/QStringUtils.h"
 #include <string>
 #include <vector>
 #include <set>
 #include <map>
+#include <memory>
 #define GL_SILENCE_DEPRECATION
 #ifdef __APPLE__
 /* Defined before OpenGL and GLUT includes to avoid deprecation messages - this doesn't actually work */
@@ -37,15 +51,6 @@ enum GraphicsMode {
   Field
 };
 
-struct GraphicsVector {
-  struct Vec3 start;
-  struct Vec3 end;
-  Color color;
-  string crossA;
-  string crossB;
-  float dotProduct;
-};
-
 struct BoundingBox {
   Vec3 min;
   Vec3 max;
@@ -71,6 +76,8 @@ public:
     } else {
       ResetCameraVectorField();
     }
+    coordinateSystemDirty = true;
+    RequestFrame();
   }
 
   void SetBackgroundColor(Color color, bool darkMode) {
@@ -83,40 +90,28 @@ public:
       backgroundColor.g += diff;
       backgroundColor.b += diff;
     }
+    RequestFrame();
   }
 
   Color AddVector(Vec3 start, Vec3 end) {
-    size_t colorIndex = 0;
-    for (const auto &Vec : vectors) {
-      if (Vec.crossA == "" && Vec.crossB == "") {
-        ++colorIndex;
-      }
-    }
+    size_t colorIndex = vectors.NumUncrossed();
     Color color = MathUtils::MediumColor(MathUtils::GetColorSpace(colorIndex));
     AddVector(start, end, color);
     return color;
   }
 
   void AddVector(Vec3 start, Vec3 end, Color color, string crossA = "", string crossB = "", float dot = 0.0f) {
-    struct GraphicsVector v;
-    v.start = start;
-    v.end = end;
-    v.color = color;
-    v.crossA = crossA;
-    v.crossB = crossB;
-    if (crossA != "" && crossB != "") {
-      v.dotProduct = dot;
-    }
-    vectors.push_back(v);
+    vectors.Add(start, end, color, crossA, crossB, dot);
 
     Debug("Added vector from start = { " + Precision(start.x) + ", " + Precision(start.y) + ", " + Precision(start.z) + " } to end = { " + Precision(end.x) + ", " + Precision(end.y) + ", " + Precision(end.z) + " }");
     SetBoundingBox();
     Debug("Bounding box: min = { " + Precision(box.min.x) + ", " + Precision(box.min.y) + ", " + Precision(box.min.z) + " }, max = { " + Precision(box.max.x) + ", " + Precision(box.max.y) + ", " + Precision(box.max.z) + " }");
+    RequestFrame();
   }
 
   Color CrossVectors(size_t a, size_t b) {
-    GraphicsVector A = vectors.at(a);
-    GraphicsVector B = vectors.at(b);
+    GraphicsVector A = vectors.At(a);
+    GraphicsVector B = vectors.At(b);
     Vec3 P = Vector::GetVector(A.start, A.end);
     Vec3 Q = Vector::GetVector(B.start, B.end);
     Vec3 C = Vector::Cross(P, Q);
@@ -128,25 +123,19 @@ public:
   }
 
   size_t NumVectors() {
-    return vectors.size();
+    return vectors.Size();
   }
 
   size_t NumNonDeletedVectors() {
-    size_t num = 0;
-    for (size_t i = 0; i < vectors.size(); ++i) {
-      if (deletedVectors.find(i) == deletedVectors.end()) {
-        ++num;
-      }
-    }
-    return num;
+    return vectors.Size() - vectors.NumDeleted();
   }
 
   bool IsVectorDeleted(size_t index) {
-    return deletedVectors.find(index) != deletedVectors.end();
+    return vectors.Has(index, VectorStore::Deleted);
   }
 
   GraphicsVector VectorAt(size_t index) {
-    return vectors.at(index);
+    return vectors.At(index);
   }
 
   // Vectors are named A, B, ..., Z, AA, BB, ..., ZZ, AAA, etc.
@@ -164,82 +153,46 @@ public:
   }
 
   void SetVectorVisibility(int state, size_t index) {
-    if (!state) {
-      disabledVectors.emplace(index);
-    } else {
-      auto I = disabledVectors.find(index);
-      if (I != disabledVectors.end()) {
-        disabledVectors.erase(I);
-      }
-    }
+    vectors.Set(index, VectorStore::Hidden, !state);
     SetBoundingBox();
+    RequestFrame();
   }
 
   void SetVectorNormalized(int state, size_t index) {
-    if (state) {
-      normalizedVectors.emplace(index);
-    } else {
-      auto I = normalizedVectors.find(index);
-      if (I != normalizedVectors.end()) {
-        normalizedVectors.erase(I);
-      }
-    }
+    vectors.Set(index, VectorStore::Normalized, state);
+    RequestFrame();
   }
 
   void SetVectorOrigin(int state, size_t index) {
-    if (state) {
-      originVectors.emplace(index);
-    } else {
-      auto I = originVectors.find(index);
-      if (I != originVectors.end()) {
-        originVectors.erase(I);
-      }
-    }
+    vectors.Set(index, VectorStore::FromOrigin, state);
+    RequestFrame();
   }
 
   void DeleteVector(size_t index) {
-    deletedVectors.emplace(index);
+    vectors.Set(index, VectorStore::Deleted, true);
+    RequestFrame();
   }
 
-  void SetFunctions(Expr *xF, Expr *yF, Expr *zF, float min, float max, int numVectors) {
+  // Shows functions sampled by SampleFunction (usually on a worker thread).
+  // arena owns the nodes of xF, yF and zF and is kept alive until the
+  // functions are replaced.
+  void SetFunctions(Expr *xF, Expr *yF, Expr *zF, float min, float max, const FunctionSamples &samples, shared_ptr<ExprArena> arena = nullptr) {
     debuggedStrings.clear();
+    funcArena = arena;
     xFunc = xF;
     yFunc = yF;
     zFunc = zF;
     tMin = min;
     tMax = max;
-    minArrLen = numeric_limits<float>::max();
-    maxArrLen = numeric_limits<float>::min();
-    funcPoints.clear();
-    arrowPoints.clear();
-    tStep = MathUtils::Abs(tMax - tMin) / (2 * numVectors);
+    funcPoints = samples.Points;
+    funcArrowIndices = samples.ArrowIndices;
+    tStep = samples.TStep;
     Debug("tStep: " + Precision(tStep));
 
-    funcBox.min = {-coordSystemLimit, -coordSystemLimit, -coordSystemLimit};
-    funcBox.max = {coordSystemLimit, coordSystemLimit, coordSystemLimit};
-    vector<float> nums = {coordSystemLimit};
-    vector<float> lens = {};
-
     currTMaxIndex = 0;
-    int tIndex = 0;
-    for (float t = tMin; t <= tMax + 0.005; t += tStep) {
-      float x = xF->Eval(t, 0, 0);
-      float y = yF->Eval(t, 0, 0);
-      float z = zF->Eval(t, 0, 0);
-      nums.push_back(x);
-      nums.push_back(y);
-      nums.push_back(z);
-      funcPoints[tIndex] = {x, y, z};
-      // Only draw an arrow at every other point
-      if (tIndex % 2 == 0) {
-        arrowPoints[tIndex] = {x, y, z};
-        lens.push_back(Vector::Length({x, y, z}));
-      }
-      ++tIndex;
-    }
 
-    float maxValue = MathUtils::Max(nums);
-    float minValue = MathUtils::Min(nums);
+    float maxValue = MathUtils::Max({coordSystemLimit, samples.MaxCoordinate});
+    float minValue = MathUtils::Min({coordSystemLimit, samples.MinCoordinate});
     Debug("maxValue initially: " + Precision(maxValue));
     maxValue = MathUtils::Max({MathUtils::Abs(maxValue), MathUtils::Abs(minValue)});
     float maxValueBeforeRound = maxValue;
@@ -253,34 +206,42 @@ public:
     funcBox.min = {-maxValue, -maxValue, -maxValue};
     funcBox.max = {maxValue, maxValue, maxValue};
 
-    maxArrLen = MathUtils::Max(lens);
-    minArrLen = MathUtils::Min(lens);
+    maxArrLen = samples.MaxArrowLength;
+    minArrLen = samples.MinArrowLength;
     Debug("minArrLen: " + Precision(minArrLen) + ", maxArrLen: " + Precision(maxArrLen));
+    UpdateFunctionGeometry();
 
     funcTime = 0;
+    coordinateSystemDirty = true;
+    RequestFrame();
   }
 
-  void SetVectorField(VectorField *field) {
+  // Takes ownership of field and its curl, built along with their length
+  // extremes by a FieldJob. The previous field and curl are deleted.
+  void SetVectorField(VectorField *field, VectorField *fieldCurl, float minFieldLength, float maxFieldLength, float minCurl, float maxCurl) {
+    delete vectorField;
+    delete curl;
     vectorField = field;
-    curl = field->Curl();
-    float x = rangeVF.x;
-    float y = rangeVF.y;
-    float z = rangeVF.z;
-    // Debug("Getting min and max lengths on range " + Precision(x, 1) + ", " + Precision(y, 1) + ", " + Precision(z, 1));
-    field->MinMaxLengths(
-      x, y, z,
-      coordSystemGridSize,
-      minVectorFieldLength,
-      maxVectorFieldLength
-    );
-    curl->MinMaxLengths(
-      x, y, z,
-      coordSystemGridSize,
-      minCurlLength,
-      maxCurlLength
-    );
+    curl = fieldCurl;
+    minVectorFieldLength = minFieldLength;
+    maxVectorFieldLength = maxFieldLength;
+    minCurlLength = minCurl;
+    maxCurlLength = maxCurl;
+    UpdateFieldArrows();
+    // Streamlines of the previous field are stale.
+    streamlines.Clear();
     // Debug("minVectorFieldLength: " + Precision(minVectorFieldLength, 3) + ", maxVectorFieldLength: " + Precision(maxVectorFieldLength, 3));
     // Debug("minCurlLength: " + Precision(minCurlLength, 3) + ", maxCurlLength: " + Precision(maxCurlLength, 3));
+    RequestFrame();
+  }
+
+  // Range and spacing of the grid on which vector field lengths are sampled.
+  Vec3 VectorFieldRange() {
+    return rangeVF;
+  }
+
+  float VectorFieldStep() {
+    return coordSystemGridSize;
   }
 
   VectorField *Curl() {
@@ -311,12 +272,16 @@ public:
     orbitCamera = orbit;
     showZMarkers = true;
     showZFuncMarkers = true;
+    coordinateSystemDirty = true;
+    RequestFrame();
   }
 
   void LookAtOriginVectors() {
     SetCameraPosition(0, 0, 5);
     cameraTime = 0.0f;
     showZMarkers = false;
+    coordinateSystemDirty = true;
+    RequestFrame();
   }
 
   void ResetCameraVectors() {
@@ -325,27 +290,70 @@ public:
     cameraTime = 0.0f;
     // showZMarkers = true;
     showZMarkers = false;
+    coordinateSystemDirty = true;
+    RequestFrame();
   }
 
   void ResetCameraFunc() {
     SetCameraPosition(0, 0, 5);
     cameraTime = 0.0f;
     showZFuncMarkers = false;
+    coordinateSystemDirty = true;
+    RequestFrame();
   }
 
   void ResetCameraVectorField() {
     SetCameraPosition(0, 0, 5);
     cameraTime = 0.0f;
+    RequestFrame();
   }
 
   void SetViewField(int state) {
     viewField = state;
+    RequestFrame();
   }
 
   void SetViewCurl(int state) {
     viewCurl = state;
+    RequestFrame();
   }
 
+  // Shows streamlines traced through the current vector field, in field
+  // coordinates within VectorFieldRange().
+  void SetStreamlines(const Streamlines &lines);
+
+  // Samples fields on an octree refined where they vary, instead of on the
+  // uniform grid.
+  void SetAdaptiveSampling(int state) {
+    adaptiveSampling = state;
+    UpdateFieldArrows();
+    RequestFrame();
+  }
+
+  void SetViewStreamlines(int state) {
+    viewStreamlines = state;
+    RequestFrame();
+  }
+
+  VectorField *CurrentVectorField() {
+    return vectorField;
+  }
+
+  // Records where frames spend their time, and shows the time, draw calls
+  // and arrows of each frame in a corner of it.
+  void SetShowProfile(bool show) {
+    Profiler::Shared().SetEnabled(show);
+    showProfile = show;
+    RequestFrame();
+  }
+
+  // Renders the scene into an image, at rest: no time passes and functions
+  // are revealed in full. Uses a context of its own on an offscreen surface,
+  // so the widget need not be shown; it should then never be shown, since
+  // buffers belong to the context they were first drawn in. Returns a null
+  // image if no context could be created.
+  QImage RenderOffscreen(int width, int height);
+
 protected:
   void initializeGL();
   void resizeGL(int w, int h);
@@ -360,6 +368,27 @@ private:
   QTextBrowser *debug;
   float time;
 
+  // Frames are drawn on demand: RequestFrame schedules one, at most
+  // maxFramesPerSecond times a second, and paintGL keeps requesting them
+  // while IsAnimating. Animations advance by the time between frames.
+  static const int maxFramesPerSecond = 60;
+  QTimer *frameTimer;
+  QElapsedTimer clock;
+  qint64 lastFrameTime = -1;
+  void RequestFrame();
+  bool IsAnimating();
+
+  // Frame stats are painted over the scene at the end of paintGL, if
+  // SetShowProfile asked for them. Not with a child widget: changing one
+  // repaints the widget under it, which would call paintGL again.
+  bool showProfile = false;
+  void DrawProfileOverlay(const QString &text);
+
+  // Context, surface and target of RenderOffscreen, created on first use.
+  QOpenGLContext *offscreenContext = nullptr;
+  QOffscreenSurface *offscreenSurface = nullptr;
+  QOpenGLFramebufferObject *offscreenTarget = nullptr;
+
   // Which kind of thing to render
   GraphicsMode mode;
 
@@ -379,15 +408,12 @@ private:
   float coordSystemZ = 5 * coordSystemGridSize;
 
   // Vector properties
-  vector<GraphicsVector> vectors;
-  set<size_t> disabledVectors;
-  set<size_t> normalizedVectors;
-  set<size_t> originVectors;
-  set<size_t> deletedVectors;
+  VectorStore vectors;
   BoundingBox box;
   bool showZMarkers;
 
   // Function properties
+  shared_ptr<ExprArena> funcArena;
   Expr *xFunc;
   Expr *yFunc;
   Expr *zFunc;
@@ -396,11 +422,19 @@ private:
   float minArrLen;
   float maxArrLen;
   int currTMaxIndex;
-  map<int, Vec3> funcPoints;
-  map<int, Vec3> arrowPoints;
+  // Samples of the functions in increasing t, and which of them get arrows.
+  vector<Vec3> funcPoints;
+  vector<int> funcArrowIndices;
+  // The curve through funcPoints and the arrows, in scene coordinates.
+  // Revealing the function only changes how much of them is drawn.
+  LineStrip funcCurve;
+  ArrowBatch funcArrows;
   float tStep;
   BoundingBox funcBox;
-  int funcTime;
+  // Seconds since the functions were set, which drives their reveal.
+  float funcTime;
+  // Two more points of the function are revealed every funcRevealSeconds.
+  static constexpr float funcRevealSeconds = 0.15f;
   bool showZFuncMarkers;
 
   // Vector field properties
@@ -412,10 +446,17 @@ private:
   float maxCurlLength;
   bool viewField;
   bool viewCurl;
+  bool viewStreamlines = false;
+  bool adaptiveSampling = false;
   string rangevf_X;
   string rangevf_Y;
   string rangevf_Z;
   struct Vec3 rangeVF;
+  // Arrows of the field and the curl, sampled once per field (and range)
+  // rather than every frame.
+  ArrowBatch fieldArrows;
+  ArrowBatch curlArrows;
+  LineBatch streamlines;
 
   void Debug(string str) {
     if (debug) {
@@ -426,7 +467,12 @@ private:
     }
   }
 
-  // Coordinate systems
+  // Coordinate systems. Each one adds the axes, grid and range markers of
+  // its mode to coordinateSystem, which is kept until coordinateSystemDirty
+  // is set by a change to the mode, ranges or markers.
+  LineBatch coordinateSystem;
+  bool coordinateSystemDirty = true;
+  void DrawCoordinateSystem();
   void CoordinateSystem();
   void CoordinateSystemFunc();
   void CoordinateSystemVF();
@@ -436,14 +482,24 @@ private:
   void SetBoundingBox();
 
   // Function
+  // Rebuilds funcCurve and funcArrows; needed whenever funcPoints, funcBox
+  // or the arrow length extremes change.
+  void UpdateFunctionGeometry();
   void Function(Expr *xF, Expr *yF, Expr *zF, int tMaxIndex);
 
   // Vector field
-  void Field(VectorField *field, Color A, Color B, float minLength, float maxLength);
+  // Resamples the cached arrows. Needed whenever the field, its length
+  // extremes or rangeVF change.
+  void UpdateFieldArrows();
+  void SampleField(VectorField *field, Color A, Color B, float minLength, float maxLength, ArrowBatch &arrows);
 
   // General drawing helpers
+  // Fixed-function state every frame relies on. Set up once, and again
+  // after QPainter, which resets it.
+  void SetGLState();
+
+  ArrowRenderer arrowRenderer;
   void Arrow(struct Vec3 start, struct Vec3 end, Color color, float thickness, float maxConeRadius = 0.07f);
-  void Line(struct Vec3 start, struct Vec3 end, Color color, float thickness);
   void Sphere(struct Vec3 point, Color color, float radius);
 
   // Camera